@@ -17,10 +17,16 @@
 #define UNICONS_UNICODE_TRAITS_HPP
 
 #include <string>
+#include <vector>
+#include <memory>
 #include <iterator>
 #include <type_traits>
+#include <utility>
 #include <system_error>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
     
 #define UNICONS_VERSION_MAJOR 0
 #define UNICONS_VERSION_MINOR 5
@@ -43,6 +49,45 @@
     #define UNICONS_THROW(exception) std::terminate()
 #endif
 
+// SIMD instruction sets are selected at compile time from the target flags
+// (e.g. -msse4.2, -mavx2, -mavx512bw or /arch:AVX2), or by defining
+// UNICONS_SSE42, UNICONS_AVX2 or UNICONS_AVX512. Define UNICONS_NO_SIMD
+// to use the portable code paths only.
+#if !defined(UNICONS_NO_SIMD)
+#  if !defined(UNICONS_AVX512) && defined(__AVX512F__) && defined(__AVX512BW__)
+#    define UNICONS_AVX512
+#  endif
+#  if !defined(UNICONS_AVX2) && (defined(__AVX2__) || defined(UNICONS_AVX512))
+#    define UNICONS_AVX2
+#  endif
+#  if !defined(UNICONS_SSE42) && (defined(__SSE4_2__) || defined(UNICONS_AVX2))
+#    define UNICONS_SSE42
+#  endif
+#endif
+
+#if defined(UNICONS_SSE42) || defined(UNICONS_AVX2) || defined(UNICONS_AVX512)
+#  include <immintrin.h>
+#endif
+
+// The functions and classes whose code depends on the instruction set are in
+// an inline namespace named after it, so that translation units built with
+// different target flags do not share definitions.
+#if defined(UNICONS_AVX512)
+#  define UNICONS_SIMD_NAMESPACE avx512
+#elif defined(UNICONS_AVX2)
+#  define UNICONS_SIMD_NAMESPACE avx2
+#elif defined(UNICONS_SSE42)
+#  define UNICONS_SIMD_NAMESPACE sse42
+#else
+#  define UNICONS_SIMD_NAMESPACE scalar
+#endif
+
+// validate with a thread count uses std::thread. Define UNICONS_NO_THREADS
+// to leave it out.
+#if !defined(UNICONS_NO_THREADS)
+#  include <thread>
+#endif
+
 namespace unicons {
 
     class unicode_error : public std::system_error
@@ -190,7 +235,9 @@ namespace unicons {
         unpaired_high_surrogate,     // unpaired high surrogate UTF-16
         illegal_surrogate_value,     // UTF-16 surrogate values are illegal in UTF-32
         source_exhausted,            // partial character in source, but hit end
-        source_illegal               // source sequence is illegal/malformed
+        source_illegal,              // source sequence is illegal/malformed
+        target_exhausted,            // insufficient room in target for the next character
+        unmappable_character         // no character in the target encoding for the codepoint
     };
 
     class Unicode_traits_error_category_impl_
@@ -217,6 +264,10 @@ namespace unicons {
                 return "Partial character in source, but hit end";
             case conv_errc::source_illegal:
                 return "Source sequence is illegal/malformed";
+            case conv_errc::target_exhausted:
+                return "Insufficient room in target for the next character";
+            case conv_errc::unmappable_character:
+                return "No character in the target encoding for the codepoint";
             default:
                 return "";
                 break;
@@ -299,50 +350,149 @@ namespace unicons {
         return std::error_code(static_cast<int>(result),encoding_error_category());
     }
 
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+    /*
+     * Table-driven UTF-8 decoder. Each byte is mapped to one of 16 classes,
+     * and the transition table is indexed by the current state plus the
+     * class of the next byte. States are premultiplied by 16, so that a
+     * state is also the offset of its row.
+     *
+     * A sequence is decoded in a single loop over its bytes, validating and
+     * accumulating the codepoint at the same time. The error states give
+     * the same conv_errc as the checks in ConvertUTF.c: a missing
+     * continuation byte takes precedence over an out of range second byte
+     * or an illegal lead byte, so the illegal states keep consuming
+     * continuation bytes before settling on source_illegal.
+     */
+
+    constexpr uint8_t utf8_accept = 0;
+    constexpr uint8_t utf8_cont1 = 16;      // one more continuation byte
+    constexpr uint8_t utf8_cont2 = 32;      // two more continuation bytes
+    constexpr uint8_t utf8_cont3 = 48;      // three more continuation bytes
+    constexpr uint8_t utf8_e0 = 64;         // after E0, A0..BF next
+    constexpr uint8_t utf8_ed = 80;         // after ED, 80..9F next
+    constexpr uint8_t utf8_f0 = 96;         // after F0, 90..BF next
+    constexpr uint8_t utf8_f4 = 112;        // after F4, 80..8F next
+    constexpr uint8_t utf8_illegal1 = 128;  // illegal, if followed by one continuation byte
+    constexpr uint8_t utf8_illegal2 = 144;  // illegal, if followed by two continuation bytes
+    constexpr uint8_t utf8_illegal3 = 160;  // illegal, if followed by three continuation bytes
+    constexpr uint8_t utf8_reject_illegal = 176;
+    constexpr uint8_t utf8_reject_continuation = 192;
+    constexpr uint8_t utf8_reject_over_long = 208;
+
+#define UNICONS_UTF8_ROW(s) s,s,s,s,s,s,s,s,s,s,s,s,s,s,s,s
+#define UNICONS_UTF8_CONT_ROW(c1,c2,c3) utf8_reject_continuation,c1,c2,c3,utf8_reject_continuation,utf8_reject_continuation,\
+    utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation,\
+    utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation,utf8_reject_continuation
+
+    // Static data members, so that a program has one copy of the tables
+    template <class T = void>
+    struct utf8_dfa_tables
+    {
+        static constexpr uint8_t utf8_byte_class[256] = {
+            // 00..7F ASCII
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            // 80..8F, 90..9F, A0..BF continuation
+            1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+            3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3, 3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
+            // C0..C1 overlong, C2..DF
+            4,4,5,5,5,5,5,5,5,5,5,5,5,5,5,5, 5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+            // E0, E1..EC, ED, EE..EF, F0, F1..F3, F4, F5..F7, F8..FF
+            6,7,7,7,7,7,7,7,7,7,7,7,7,8,7,7, 9,10,10,10,11,12,12,12,13,13,13,13,13,13,13,13
+        };
+
+        // Mask for the payload bits of a lead byte, by class
+        static constexpr uint8_t utf8_lead_mask[16] = {
+            0x7F,0,0,0,0x1F,0x1F,0x0F,0x0F,0x0F,0x07,0x07,0x07,0x07,0,0,0
+        };
+
+        static constexpr uint8_t utf8_transitions[224] = {
+            // accept: by class of the lead byte
+            utf8_accept, utf8_reject_illegal, utf8_reject_illegal, utf8_reject_illegal,
+            utf8_illegal1, utf8_cont1, utf8_e0, utf8_cont2, utf8_ed, utf8_f0, utf8_cont3, utf8_f4,
+            utf8_illegal3, utf8_reject_over_long, utf8_reject_over_long, utf8_reject_over_long,
+            // cont1, cont2, cont3
+            UNICONS_UTF8_CONT_ROW(utf8_accept, utf8_accept, utf8_accept),
+            UNICONS_UTF8_CONT_ROW(utf8_cont1, utf8_cont1, utf8_cont1),
+            UNICONS_UTF8_CONT_ROW(utf8_cont2, utf8_cont2, utf8_cont2),
+            // e0, ed, f0, f4
+            UNICONS_UTF8_CONT_ROW(utf8_illegal1, utf8_illegal1, utf8_cont1),
+            UNICONS_UTF8_CONT_ROW(utf8_cont1, utf8_cont1, utf8_illegal1),
+            UNICONS_UTF8_CONT_ROW(utf8_illegal2, utf8_cont2, utf8_cont2),
+            UNICONS_UTF8_CONT_ROW(utf8_cont2, utf8_illegal2, utf8_illegal2),
+            // illegal1, illegal2, illegal3
+            UNICONS_UTF8_CONT_ROW(utf8_reject_illegal, utf8_reject_illegal, utf8_reject_illegal),
+            UNICONS_UTF8_CONT_ROW(utf8_illegal1, utf8_illegal1, utf8_illegal1),
+            UNICONS_UTF8_CONT_ROW(utf8_illegal2, utf8_illegal2, utf8_illegal2),
+            // reject states are final
+            UNICONS_UTF8_ROW(utf8_reject_illegal),
+            UNICONS_UTF8_ROW(utf8_reject_continuation),
+            UNICONS_UTF8_ROW(utf8_reject_over_long)
+        };
+
+        // Result by state, a sequence that ends in the middle is short
+        static constexpr conv_errc utf8_state_errc[14] = {
+            conv_errc(),
+            conv_errc::source_exhausted, conv_errc::source_exhausted, conv_errc::source_exhausted,
+            conv_errc::source_exhausted, conv_errc::source_exhausted, conv_errc::source_exhausted, conv_errc::source_exhausted,
+            conv_errc::source_exhausted, conv_errc::source_exhausted, conv_errc::source_exhausted,
+            conv_errc::source_illegal, conv_errc::expected_continuation_byte, conv_errc::over_long_utf8_sequence
+        };
+    };
+
+#undef UNICONS_UTF8_ROW
+#undef UNICONS_UTF8_CONT_ROW
+
+    template <class T>
+    constexpr uint8_t utf8_dfa_tables<T>::utf8_byte_class[256];
+    template <class T>
+    constexpr uint8_t utf8_dfa_tables<T>::utf8_lead_mask[16];
+    template <class T>
+    constexpr uint8_t utf8_dfa_tables<T>::utf8_transitions[224];
+    template <class T>
+    constexpr conv_errc utf8_dfa_tables<T>::utf8_state_errc[14];
+
+    // Decodes the sequence of length bytes that begins at first, where length is
+    // given by trailing_bytes_for_utf8. On error ch is unspecified.
+    template <typename Iterator>
+    conv_errc decode_utf8(Iterator first, std::size_t length, uint32_t& ch) noexcept
+    {
+        typedef utf8_dfa_tables<> tables;
+
+        uint8_t byte = static_cast<uint8_t>(*first);
+        uint8_t cls = tables::utf8_byte_class[byte];
+        unsigned state = tables::utf8_transitions[cls];
+        ch = byte & tables::utf8_lead_mask[cls];
+        for (std::size_t i = 1; i < length; ++i)
+        {
+            byte = static_cast<uint8_t>(*++first);
+            state = tables::utf8_transitions[state + tables::utf8_byte_class[byte]];
+            ch = (ch << 6) | (byte & 0x3F);
+        }
+        return tables::utf8_state_errc[state >> 4];
+    }
+
+} // namespace detail
+
     // utf8
 
     template <typename Iterator>
-    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value, 
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,
                                   conv_errc >::type
-    is_legal_utf8(Iterator first, std::size_t length) 
+    is_legal_utf8(Iterator first, std::size_t length)
     {
-        uint8_t a;
-        Iterator srcptr = first+length;
-        switch (length) {
-        default:
+        if (length == 0 || length > 4)
+        {
             return conv_errc::over_long_utf8_sequence;
-        case 4:
-            if (((a = (*--srcptr))& 0xC0) != 0x80)
-                return conv_errc::expected_continuation_byte;
-            UNICONS_FALLTHROUGH;
-        case 3:
-            if (((a = (*--srcptr))& 0xC0) != 0x80)
-                return conv_errc::expected_continuation_byte;
-            UNICONS_FALLTHROUGH;
-        case 2:
-            if (((a = (*--srcptr))& 0xC0) != 0x80)
-                return conv_errc::expected_continuation_byte;
-
-            switch (static_cast<uint8_t>(*first)) 
-            {
-                /* no fall-through in this inner switch */
-                case 0xE0: if (a < 0xA0) return conv_errc::source_illegal; break;
-                case 0xED: if (a > 0x9F) return conv_errc::source_illegal; break;
-                case 0xF0: if (a < 0x90) return conv_errc::source_illegal; break;
-                case 0xF4: if (a > 0x8F) return conv_errc::source_illegal; break;
-                default:   if (a < 0x80) return conv_errc::source_illegal;
-            }
-
-            UNICONS_FALLTHROUGH;
-        case 1:
-            if (static_cast<uint8_t>(*first) >= 0x80 && static_cast<uint8_t>(*first) < 0xC2)
-                return conv_errc::source_illegal;
-            break;
         }
-        if (static_cast<uint8_t>(*first) > 0xF4) 
-            return conv_errc::source_illegal;
-
-        return conv_errc();
+        uint32_t ch;
+        return detail::decode_utf8(first, length, ch);
     }
 
     template <typename, typename, typename = void>
@@ -394,1419 +544,6891 @@ namespace unicons {
                                 && is_same_size<typename OutputIt::char_type,CharT>::value>::type
     > : std::true_type {};
 
-    // convert
+namespace detail {
+
+    // is_contiguous_iterator
+
+    template <typename CharT, typename Enable=void>
+    struct has_char_traits : std::false_type {};
+
+    template <typename CharT>
+    struct has_char_traits<CharT, typename std::enable_if<std::is_same<CharT,char>::value ||
+                                                          std::is_same<CharT,wchar_t>::value ||
+                                                          std::is_same<CharT,char16_t>::value ||
+                                                          std::is_same<CharT,char32_t>::value>::type> : std::true_type {};
+
+    template <typename Iterator, typename CharT, typename Enable=void>
+    struct is_string_iterator : std::false_type {};
+
+    template <typename Iterator, typename CharT>
+    struct is_string_iterator<Iterator, CharT, typename std::enable_if<has_char_traits<CharT>::value>::type>
+        : std::integral_constant<bool, std::is_same<Iterator,typename std::basic_string<CharT>::iterator>::value ||
+                                       std::is_same<Iterator,typename std::basic_string<CharT>::const_iterator>::value> {};
+
+    template <typename Iterator, typename CharT>
+    struct is_vector_iterator
+        : std::integral_constant<bool, std::is_same<Iterator,typename std::vector<CharT>::iterator>::value ||
+                                       std::is_same<Iterator,typename std::vector<CharT>::const_iterator>::value> {};
+
+    template <typename Iterator, typename Enable=void>
+    struct is_contiguous_iterator : std::false_type {};
+
+    template <typename CharT>
+    struct is_contiguous_iterator<CharT*, typename std::enable_if<is_character<typename std::remove_cv<CharT>::type>::value>::type>
+        : std::true_type {};
 
     template <typename Iterator>
-    struct convert_result
+    struct is_contiguous_iterator<Iterator, typename std::enable_if<!std::is_pointer<Iterator>::value &&
+                                                                    is_character<typename std::iterator_traits<Iterator>::value_type>::value>::type>
+        : std::integral_constant<bool, is_string_iterator<Iterator,typename std::iterator_traits<Iterator>::value_type>::value ||
+                                       is_vector_iterator<Iterator,typename std::iterator_traits<Iterator>::value_type>::value> {};
+
+    // Only called on a non-empty range
+    template <typename CodeUnit, typename Iterator>
+    const CodeUnit* code_units(Iterator it) noexcept
     {
-        Iterator it;
-        conv_errc ec;
-    };
+        return reinterpret_cast<const CodeUnit*>(std::addressof(*it));
+    }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
-                            && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, OutputIt target, conv_flags flags=conv_flags::strict) 
+    // Reads the code unit at p. A range of char16_t, char32_t or wchar_t is 
+    // accessed through a pointer to uint16_t or uint32_t, and only memcpy or 
+    // a SIMD load may read it that way
+    template <typename CodeUnit>
+    CodeUnit load_unit(const CodeUnit* p) noexcept
     {
-        (void)flags;
+        CodeUnit unit;
+        std::memcpy(&unit, p, sizeof(CodeUnit));
+        return unit;
+    }
 
-        conv_errc  result = conv_errc();
-        while (first != last) 
+    template <typename Iterator>
+    Iterator advance_by(Iterator it, std::size_t n) noexcept
+    {
+        return it + static_cast<typename std::iterator_traits<Iterator>::difference_type>(n);
+    }
+
+    // Returns the start of the last sequence in the valid prefix [data, data+length)
+    // if that sequence is cut off at data+length, otherwise length
+    inline
+    std::size_t utf8_sequence_boundary(const uint8_t* data, std::size_t length) noexcept
+    {
+        std::size_t back = length < 3 ? length : 3;
+        for (std::size_t i = 1; i <= back; ++i)
         {
-            std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)] + 1;
-            if (length > (std::size_t)(last - first))
+            uint8_t ch = data[length - i];
+            if (!is_continuation_byte(ch))
             {
-                return convert_result<InputIt>{first, conv_errc::source_exhausted};
-            }
-            if ((result=is_legal_utf8(first, length)) != conv_errc())
-            {
-                return convert_result<InputIt>{first,result};
-            }
-
-            switch (length) {
-                case 4: *target++ = (static_cast<uint8_t>(*first++));
-                    UNICONS_FALLTHROUGH;
-                case 3: *target++ = (static_cast<uint8_t>(*first++));
-                    UNICONS_FALLTHROUGH;
-                case 2: *target++ = (static_cast<uint8_t>(*first++));
-                    UNICONS_FALLTHROUGH;
-                case 1: *target++ = (static_cast<uint8_t>(*first++));
+                return (std::size_t)trailing_bytes_for_utf8[ch] + 1 > i ? length - i : length;
             }
         }
-        return convert_result<InputIt>{first,result} ;
+        return length;
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    /*
+     * Block-at-a-time UTF-8 validation using the lookup algorithm of
+     * Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+     * The high and low nibbles of each byte and the high nibble of the byte
+     * that follows index three 16-entry tables, whose entries are bit sets of
+     * the errors that the pair may be part of. The AND of the three lookups is
+     * non-zero if the pair is in error, except where a third or fourth byte
+     * is expected to be a continuation byte.
+     */
+
+    constexpr uint8_t utf8_too_short = 1 << 0;    // 11______ 0_______ or 11______ 11______
+    constexpr uint8_t utf8_too_long = 1 << 1;     // 0_______ 10______
+    constexpr uint8_t utf8_overlong_3 = 1 << 2;   // 11100000 100_____
+    constexpr uint8_t utf8_too_large = 1 << 3;    // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+    constexpr uint8_t utf8_surrogate = 1 << 4;    // 11101101 101_____
+    constexpr uint8_t utf8_overlong_2 = 1 << 5;   // 1100000_ 10______
+    constexpr uint8_t utf8_too_large_1000 = 1 << 6; // 11110101+ 1000____
+    constexpr uint8_t utf8_overlong_4 = 1 << 6;   // 11110000 1000____
+    constexpr uint8_t utf8_two_conts = 1 << 7;    // 10______ 10______
+    constexpr uint8_t utf8_carry = utf8_too_short | utf8_too_long | utf8_two_conts;
+
+    // A static data member of a class template has one definition in a program,
+    // however many translation units include this header
+    template <class T = void>
+    struct utf8_lookup_tables
     {
-        conv_errc  result = conv_errc();
+        static constexpr uint8_t utf8_byte_1_high[16] = {
+            // 0_______ ________ ASCII in byte 1
+            utf8_too_long, utf8_too_long, utf8_too_long, utf8_too_long,
+            utf8_too_long, utf8_too_long, utf8_too_long, utf8_too_long,
+            // 10______ ________ continuation in byte 1
+            utf8_two_conts, utf8_two_conts, utf8_two_conts, utf8_two_conts,
+            // 1100____ ________ two byte lead in byte 1
+            utf8_too_short | utf8_overlong_2,
+            // 1101____ ________ two byte lead in byte 1
+            utf8_too_short,
+            // 1110____ ________ three byte lead in byte 1
+            utf8_too_short | utf8_overlong_3 | utf8_surrogate,
+            // 1111____ ________ four+ byte lead in byte 1
+            utf8_too_short | utf8_too_large | utf8_too_large_1000 | utf8_overlong_4
+        };
+
+        static constexpr uint8_t utf8_byte_1_low[16] = {
+            // ____0000 ________
+            utf8_carry | utf8_overlong_3 | utf8_overlong_2 | utf8_overlong_4,
+            // ____0001 ________
+            utf8_carry | utf8_overlong_2,
+            // ____001_ ________
+            utf8_carry,
+            utf8_carry,
+            // ____0100 ________
+            utf8_carry | utf8_too_large,
+            // ____0101 ________
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            // ____011_ ________
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            // ____1___ ________
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            // ____1101 ________
+            utf8_carry | utf8_too_large | utf8_too_large_1000 | utf8_surrogate,
+            utf8_carry | utf8_too_large | utf8_too_large_1000,
+            utf8_carry | utf8_too_large | utf8_too_large_1000
+        };
+
+        static constexpr uint8_t utf8_byte_2_high[16] = {
+            // ________ 0_______ ASCII in byte 2
+            utf8_too_short, utf8_too_short, utf8_too_short, utf8_too_short,
+            utf8_too_short, utf8_too_short, utf8_too_short, utf8_too_short,
+            // ________ 1000____
+            utf8_too_long | utf8_overlong_2 | utf8_two_conts | utf8_overlong_3 | utf8_too_large_1000 | utf8_overlong_4,
+            // ________ 1001____
+            utf8_too_long | utf8_overlong_2 | utf8_two_conts | utf8_overlong_3 | utf8_too_large,
+            // ________ 101_____
+            utf8_too_long | utf8_overlong_2 | utf8_two_conts | utf8_surrogate | utf8_too_large,
+            utf8_too_long | utf8_overlong_2 | utf8_two_conts | utf8_surrogate | utf8_too_large,
+            // ________ 11______
+            utf8_too_short, utf8_too_short, utf8_too_short, utf8_too_short
+        };
+
+        // A block is incomplete if any of its last three bytes is a lead byte
+        // that needs more bytes than remain in the block
+        static constexpr uint8_t utf8_max_incomplete[64] = {
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xEF,0xDF,0xBF
+        };
+    };
 
-        while (first != last) 
+    template <class T>
+    constexpr uint8_t utf8_lookup_tables<T>::utf8_byte_1_high[16];
+    template <class T>
+    constexpr uint8_t utf8_lookup_tables<T>::utf8_byte_1_low[16];
+    template <class T>
+    constexpr uint8_t utf8_lookup_tables<T>::utf8_byte_2_high[16];
+    template <class T>
+    constexpr uint8_t utf8_lookup_tables<T>::utf8_max_incomplete[64];
+
+#if defined(UNICONS_SSE42)
+
+    struct simd128
+    {
+        typedef __m128i reg;
+        static constexpr std::size_t size = 16;
+
+        static reg load(const uint8_t* p) noexcept {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));}
+        static reg table(const uint8_t* t) noexcept {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(t));}
+        static reg splat(uint8_t c) noexcept {return _mm_set1_epi8(static_cast<char>(c));}
+        static reg zero() noexcept {return _mm_setzero_si128();}
+        static reg lookup(reg t, reg index) noexcept {return _mm_shuffle_epi8(t, index);}
+        static reg shr4(reg x) noexcept {return _mm_and_si128(_mm_srli_epi16(x, 4), splat(0x0F));}
+        static reg bit_and(reg a, reg b) noexcept {return _mm_and_si128(a, b);}
+        static reg bit_or(reg a, reg b) noexcept {return _mm_or_si128(a, b);}
+        static reg bit_xor(reg a, reg b) noexcept {return _mm_xor_si128(a, b);}
+        static reg subs(reg a, reg b) noexcept {return _mm_subs_epu8(a, b);}
+        static bool is_ascii(reg x) noexcept {return _mm_movemask_epi8(x) == 0;}
+        static bool any(reg x) noexcept {return _mm_testz_si128(x, x) == 0;}
+
+        // the input shifted right N bytes, with the last N bytes of the previous input shifted in
+        template <int N>
+        static reg prev(reg input, reg prev_input) noexcept {return _mm_alignr_epi8(input, prev_input, 16 - N);}
+
+        // UTF-16 blocks of 16 code units, two mask bits per code unit
+        static constexpr std::size_t utf16_block_size = 16;
+        static constexpr unsigned utf16_mask_bits = 2;
+
+        static void utf16_surrogates(const uint16_t* p, uint32_t& high, uint32_t& low) noexcept
         {
-            uint32_t ch = 0;
-            unsigned short extra_bytes_to_read = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)];
-            if (extra_bytes_to_read >= last - first) 
+            const __m128i mask = _mm_set1_epi16(static_cast<short>(0xFC00));
+            const __m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), mask);
+            const __m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)), mask);
+            const __m128i high_start = _mm_set1_epi16(static_cast<short>(sur_high_start));
+            const __m128i low_start = _mm_set1_epi16(static_cast<short>(sur_low_start));
+            high = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(a, high_start))) |
+                   (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(b, high_start))) << 16);
+            low = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(a, low_start))) |
+                  (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(b, low_start))) << 16);
+        }
+
+        // UTF-32 blocks of 8 code units
+        static constexpr std::size_t utf32_block_size = 8;
+
+        static bool utf32_illegal(__m128i x) noexcept
+        {
+            // x > max_legal_utf32, or x - sur_high_start <= sur_low_end - sur_high_start, unsigned
+            const __m128i s = _mm_sub_epi32(x, _mm_set1_epi32(static_cast<int>(sur_high_start)));
+            const __m128i above = _mm_xor_si128(_mm_cmpeq_epi32(_mm_min_epu32(x, _mm_set1_epi32(static_cast<int>(max_legal_utf32))), x),
+                                                _mm_set1_epi32(-1));
+            const __m128i surrogate = _mm_cmpeq_epi32(_mm_min_epu32(s, _mm_set1_epi32(static_cast<int>(sur_low_end - sur_high_start))), s);
+            return _mm_movemask_epi8(_mm_or_si128(above, surrogate)) != 0;
+        }
+
+        static bool utf32_legal(const uint32_t* p) noexcept
+        {
+            return !(utf32_illegal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) ||
+                     utf32_illegal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4))));
+        }
+    };
+
+#endif
+
+#if defined(UNICONS_AVX2)
+
+    struct simd256
+    {
+        typedef __m256i reg;
+        static constexpr std::size_t size = 32;
+
+        static reg load(const uint8_t* p) noexcept {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+        static reg table(const uint8_t* t) noexcept {return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));}
+        static reg splat(uint8_t c) noexcept {return _mm256_set1_epi8(static_cast<char>(c));}
+        static reg zero() noexcept {return _mm256_setzero_si256();}
+        static reg lookup(reg t, reg index) noexcept {return _mm256_shuffle_epi8(t, index);}
+        static reg shr4(reg x) noexcept {return _mm256_and_si256(_mm256_srli_epi16(x, 4), splat(0x0F));}
+        static reg bit_and(reg a, reg b) noexcept {return _mm256_and_si256(a, b);}
+        static reg bit_or(reg a, reg b) noexcept {return _mm256_or_si256(a, b);}
+        static reg bit_xor(reg a, reg b) noexcept {return _mm256_xor_si256(a, b);}
+        static reg subs(reg a, reg b) noexcept {return _mm256_subs_epu8(a, b);}
+        static bool is_ascii(reg x) noexcept {return _mm256_movemask_epi8(x) == 0;}
+        static bool any(reg x) noexcept {return _mm256_testz_si256(x, x) == 0;}
+
+        template <int N>
+        static reg prev(reg input, reg prev_input) noexcept
+        {
+            return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+        }
+
+        static constexpr std::size_t utf16_block_size = 16;
+        static constexpr unsigned utf16_mask_bits = 2;
+
+        static void utf16_surrogates(const uint16_t* p, uint32_t& high, uint32_t& low) noexcept
+        {
+            const __m256i a = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                               _mm256_set1_epi16(static_cast<short>(0xFC00)));
+            high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, _mm256_set1_epi16(static_cast<short>(sur_high_start)))));
+            low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, _mm256_set1_epi16(static_cast<short>(sur_low_start)))));
+        }
+
+        static constexpr std::size_t utf32_block_size = 8;
+
+        static bool utf32_legal(const uint32_t* p) noexcept
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i s = _mm256_sub_epi32(x, _mm256_set1_epi32(static_cast<int>(sur_high_start)));
+            const __m256i in_range = _mm256_cmpeq_epi32(_mm256_min_epu32(x, _mm256_set1_epi32(static_cast<int>(max_legal_utf32))), x);
+            const __m256i surrogate = _mm256_cmpeq_epi32(_mm256_min_epu32(s, _mm256_set1_epi32(static_cast<int>(sur_low_end - sur_high_start))), s);
+            return _mm256_movemask_epi8(_mm256_andnot_si256(surrogate, in_range)) == -1;
+        }
+    };
+
+#endif
+
+#if defined(UNICONS_AVX512)
+
+    struct simd512
+    {
+        typedef __m512i reg;
+        static constexpr std::size_t size = 64;
+
+        static reg load(const uint8_t* p) noexcept {return _mm512_loadu_si512(reinterpret_cast<const void*>(p));}
+        static reg table(const uint8_t* t) noexcept {return _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));}
+        static reg splat(uint8_t c) noexcept {return _mm512_set1_epi8(static_cast<char>(c));}
+        static reg zero() noexcept {return _mm512_setzero_si512();}
+        static reg lookup(reg t, reg index) noexcept {return _mm512_shuffle_epi8(t, index);}
+        static reg shr4(reg x) noexcept {return _mm512_and_si512(_mm512_srli_epi16(x, 4), splat(0x0F));}
+        static reg bit_and(reg a, reg b) noexcept {return _mm512_and_si512(a, b);}
+        static reg bit_or(reg a, reg b) noexcept {return _mm512_or_si512(a, b);}
+        static reg bit_xor(reg a, reg b) noexcept {return _mm512_xor_si512(a, b);}
+        static reg subs(reg a, reg b) noexcept {return _mm512_subs_epu8(a, b);}
+        static bool is_ascii(reg x) noexcept {return _mm512_movepi8_mask(x) == 0;}
+        static bool any(reg x) noexcept {return _mm512_test_epi8_mask(x, x) != 0;}
+
+        template <int N>
+        static reg prev(reg input, reg prev_input) noexcept
+        {
+            return _mm512_alignr_epi8(input, _mm512_permutex2var_epi64(prev_input, _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6), input), 16 - N);
+        }
+
+        static constexpr std::size_t utf16_block_size = 32;
+        static constexpr unsigned utf16_mask_bits = 1;
+
+        static void utf16_surrogates(const uint16_t* p, uint32_t& high, uint32_t& low) noexcept
+        {
+            const __m512i a = _mm512_and_si512(_mm512_loadu_si512(reinterpret_cast<const void*>(p)),
+                                               _mm512_set1_epi16(static_cast<short>(0xFC00)));
+            high = _mm512_cmpeq_epi16_mask(a, _mm512_set1_epi16(static_cast<short>(sur_high_start)));
+            low = _mm512_cmpeq_epi16_mask(a, _mm512_set1_epi16(static_cast<short>(sur_low_start)));
+        }
+
+        static constexpr std::size_t utf32_block_size = 16;
+
+        static bool utf32_legal(const uint32_t* p) noexcept
+        {
+            const __m512i x = _mm512_loadu_si512(reinterpret_cast<const void*>(p));
+            const __m512i s = _mm512_sub_epi32(x, _mm512_set1_epi32(static_cast<int>(sur_high_start)));
+            return (_mm512_cmpgt_epu32_mask(x, _mm512_set1_epi32(static_cast<int>(max_legal_utf32))) |
+                    _mm512_cmple_epu32_mask(s, _mm512_set1_epi32(static_cast<int>(sur_low_end - sur_high_start)))) == 0;
+        }
+    };
+
+#endif
+
+    // Returns the length of the longest prefix of [data, data+length) that
+    // the SIMD kernel can vouch for, always ending on a sequence boundary.
+    // The remainder, including the first error if any, is left to the
+    // scalar code, so that errors are reported exactly as before.
+    template <typename Simd>
+    std::size_t utf8_valid_prefix(const uint8_t* data, std::size_t length) noexcept
+    {
+        typedef typename Simd::reg reg;
+
+        const reg byte_1_high = Simd::table(utf8_lookup_tables<>::utf8_byte_1_high);
+        const reg byte_1_low = Simd::table(utf8_lookup_tables<>::utf8_byte_1_low);
+        const reg byte_2_high = Simd::table(utf8_lookup_tables<>::utf8_byte_2_high);
+        const reg max_incomplete = Simd::load(utf8_lookup_tables<>::utf8_max_incomplete + (64 - Simd::size));
+
+        reg prev_input = Simd::zero();
+        reg prev_incomplete = Simd::zero();
+
+        std::size_t pos = 0;
+        while (length - pos >= Simd::size)
+        {
+            reg input = Simd::load(data + pos);
+            reg error;
+            if (Simd::is_ascii(input))
             {
-                result = conv_errc::source_exhausted; 
-                break;
+                error = prev_incomplete;
             }
-            /* Do this check whether lenient or strict */
-            if ((result=is_legal_utf8(first, extra_bytes_to_read+1)) != conv_errc())
+            else
             {
-                break;
+                reg prev1 = Simd::template prev<1>(input, prev_input);
+                reg special = Simd::bit_and(Simd::bit_and(Simd::lookup(byte_1_high, Simd::shr4(prev1)),
+                                                          Simd::lookup(byte_1_low, Simd::bit_and(prev1, Simd::splat(0x0F)))),
+                                            Simd::lookup(byte_2_high, Simd::shr4(input)));
+                // third and fourth bytes must be continuation bytes, which the lookup
+                // has flagged as two continuations in a row
+                reg is_third_byte = Simd::subs(Simd::template prev<2>(input, prev_input), Simd::splat(0xE0-0x80));
+                reg is_fourth_byte = Simd::subs(Simd::template prev<3>(input, prev_input), Simd::splat(0xF0-0x80));
+                reg must_be_continuation = Simd::bit_and(Simd::bit_or(is_third_byte, is_fourth_byte), Simd::splat(0x80));
+                error = Simd::bit_xor(must_be_continuation, special);
+                prev_incomplete = Simd::subs(input, max_incomplete);
             }
-            /*
-             * The cases all fall through. See "Note A" below.
-             */
-            switch (extra_bytes_to_read) {
-                case 5: ch += static_cast<uint8_t>(*first++); ch <<= 6; UNICONS_FALLTHROUGH; /* remember, illegal UTF-8 */
-                case 4: ch += static_cast<uint8_t>(*first++); ch <<= 6; UNICONS_FALLTHROUGH; /* remember, illegal UTF-8 */
-                case 3: ch += static_cast<uint8_t>(*first++); ch <<= 6; UNICONS_FALLTHROUGH;
-                case 2: ch += static_cast<uint8_t>(*first++); ch <<= 6; UNICONS_FALLTHROUGH;
-                case 1: ch += static_cast<uint8_t>(*first++); ch <<= 6; UNICONS_FALLTHROUGH;
-                case 0: ch += static_cast<uint8_t>(*first++); break;
+            if (Simd::any(error))
+            {
+                break;
             }
-            ch -= offsets_from_utf8[extra_bytes_to_read];
+            prev_input = input;
+            pos += Simd::size;
+        }
+        return utf8_sequence_boundary(data, pos);
+    }
 
-            if (ch <= max_bmp) { /* Target is a character <= 0xFFFF */
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_surrogate(ch) ) {
-                    if (flags == conv_flags::strict) {
-                        first -= (extra_bytes_to_read+1); /* return to the illegal value itself */
-                        result = conv_errc::source_illegal;
-                        break;
-                    } else {
-                        *target++ = (replacement_char);
-                    }
-                } else {
-                    *target++ = ((uint16_t)ch); /* normal case */
-                }
-            } else if (ch > max_utf16) {
-                if (flags == conv_flags::strict) {
-                    result = conv_errc::source_illegal;
-                    first -= (extra_bytes_to_read+1); /* return to the start */
-                    break; /* Bail out; shouldn't continue */
-                } else {
-                    *target++ = (replacement_char);
-                }
-            } else {
-                /* target is a character in range 0xFFFF - 0x10FFFF. */
-                ch -= half_base;
-                *target++ = ((uint16_t)((ch >> half_shift) + sur_high_start));
-                *target++ = ((uint16_t)((ch & half_mask) + sur_low_start));
-            }
+    inline
+    std::size_t utf8_valid_prefix(const uint8_t* data, std::size_t length) noexcept
+    {
+#if defined(UNICONS_AVX512)
+        return utf8_valid_prefix<simd512>(data, length);
+#elif defined(UNICONS_AVX2)
+        return utf8_valid_prefix<simd256>(data, length);
+#elif defined(UNICONS_SSE42)
+        return utf8_valid_prefix<simd128>(data, length);
+#else
+        (void)data;
+        (void)length;
+        return 0;
+#endif
+    }
+
+    // skip_valid_utf8
+
+    template <typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf8(InputIt first, InputIt last) noexcept
+    {
+        if (first == last)
+        {
+            return first;
         }
-        return convert_result<InputIt>{first,result} ;
+        std::size_t length = static_cast<std::size_t>(last - first);
+        return advance_by(first, utf8_valid_prefix(code_units<uint8_t>(first), length));
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-                     OutputIt target, 
-                     conv_flags flags = conv_flags::strict) 
+    template <typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf8(InputIt first, InputIt) noexcept
     {
-        conv_errc  result = conv_errc();
+        return first;
+    }
 
-        while (first < last) 
+    // Returns the length of the longest prefix of [data, data+length) that the
+    // SIMD kernel can vouch for. Each block is classified into high and low
+    // surrogates, and every low surrogate must follow a high surrogate,
+    // including a high surrogate carried over from the previous block.
+    // A prefix never ends with a high surrogate.
+    template <typename Simd>
+    std::size_t utf16_valid_prefix(const uint16_t* data, std::size_t length) noexcept
+    {
+        const unsigned bits = Simd::utf16_mask_bits;
+
+        uint32_t carry = 0;
+        std::size_t pos = 0;
+        while (length - pos >= Simd::utf16_block_size)
         {
-            uint32_t ch = 0;
-            unsigned short extra_bytes_to_read = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)];
-            if (extra_bytes_to_read >= last - first) 
+            uint32_t high, low;
+            Simd::utf16_surrogates(data + pos, high, low);
+            if (low != ((high << bits) | carry))
             {
-                result = conv_errc::source_exhausted; 
-                break;
-            }
-            /* Do this check whether lenient or strict */
-            if ((result=is_legal_utf8(first, extra_bytes_to_read+1)) != conv_errc()) {
                 break;
             }
-            /*
-             * The cases all fall through. See "Note A" below.
-             */
-            switch (extra_bytes_to_read) 
-            {
-                case 5: 
-                    ch += static_cast<uint8_t>(*first++); 
-                    ch <<= 6;
-                    UNICONS_FALLTHROUGH;
-                case 4: 
-                    ch += static_cast<uint8_t>(*first++); 
-                    ch <<= 6;
-                    UNICONS_FALLTHROUGH;
-                case 3: 
-                    ch += static_cast<uint8_t>(*first++); 
-                    ch <<= 6;
-                    UNICONS_FALLTHROUGH;
-                case 2: 
-                    ch += static_cast<uint8_t>(*first++); 
-                    ch <<= 6;
-                    UNICONS_FALLTHROUGH;
-                case 1: 
-                    ch += static_cast<uint8_t>(*first++); 
-                    ch <<= 6;
-                    UNICONS_FALLTHROUGH;
-                case 0: 
-                    ch += static_cast<uint8_t>(*first++);
-                    break;
-            }
-            ch -= offsets_from_utf8[extra_bytes_to_read];
-
-            if (ch <= max_legal_utf32) {
-                /*
-                 * UTF-16 surrogate values are illegal in UTF-32, and anything
-                 * over Plane 17 (> 0x10FFFF) is illegal.
-                 */
-                if (is_surrogate(ch) ) {
-                    if (flags == conv_flags::strict) {
-                        first -= (extra_bytes_to_read+1); /* return to the illegal value itself */
-                        result = conv_errc::source_illegal;
-                        break;
-                    } else {
-                        *target++ = (replacement_char);
-                    }
-                } else {
-                    *target++ = (ch);
-                }
-            } else { /* i.e., ch > max_legal_utf32 */
-                result = conv_errc::source_illegal;
-                *target++ = (replacement_char);
-            }
+            carry = high >> (32 - bits);
+            pos += Simd::utf16_block_size;
         }
-        return convert_result<InputIt>{first,result} ;
+        return carry != 0 ? pos - 1 : pos;
     }
 
-    // utf16
-
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-                     OutputIt target, 
-                     conv_flags flags = conv_flags::strict) {
-        conv_errc  result = conv_errc();
-        while (first < last) {
-            unsigned short bytes_to_write = 0;
-            const uint32_t byteMask = 0xBF;
-            const uint32_t byteMark = 0x80; 
-            uint32_t ch = *first++;
-            /* If we have a surrogate pair, convert to uint32_t first. */
-            if (is_high_surrogate(ch)) {
-                /* If the 16 bits following the high surrogate are in the first buffer... */
-                if (first < last) {
-                    uint32_t ch2 = *first;
-                    /* If it's a low surrogate, convert to uint32_t. */
-                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
-                        ch = ((ch - sur_high_start) << half_shift)
-                            + (ch2 - sur_low_start) + half_base;
-                        ++first;
-                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
-                        --first; /* return to the illegal value itself */
-                        result = conv_errc::unpaired_high_surrogate;
-                        break;
-                    }
-                } else { /* We don't have the 16 bits following the high surrogate. */
-                    --first; /* return to the high surrogate */
-                    result = conv_errc::source_exhausted;
-                    break;
-                }
-            } else if (flags == conv_flags::strict) {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_low_surrogate(ch)) {
-                    --first; /* return to the illegal value itself */
-                    result = conv_errc::source_illegal;
-                    break;
-                }
-            }
-            /* Figure out how many bytes the result will require */
-            if (ch < (uint32_t)0x80) {      
-                bytes_to_write = 1;
-            } else if (ch < (uint32_t)0x800) {     
-                bytes_to_write = 2;
-            } else if (ch < (uint32_t)0x10000) {   
-                bytes_to_write = 3;
-            } else if (ch < (uint32_t)0x110000) {  
-                bytes_to_write = 4;
-            } else {                            
-                bytes_to_write = 3;
-                ch = replacement_char;
-            }
-            
-            uint8_t byte1 = 0;
-            uint8_t byte2 = 0;
-            uint8_t byte3 = 0;
-            uint8_t byte4 = 0;
+    inline
+    std::size_t utf16_valid_prefix(const uint16_t* data, std::size_t length) noexcept
+    {
+#if defined(UNICONS_AVX512)
+        return utf16_valid_prefix<simd512>(data, length);
+#elif defined(UNICONS_AVX2)
+        return utf16_valid_prefix<simd256>(data, length);
+#elif defined(UNICONS_SSE42)
+        return utf16_valid_prefix<simd128>(data, length);
+#else
+        (void)data;
+        (void)length;
+        return 0;
+#endif
+    }
 
-            switch (bytes_to_write) { // note: everything falls through
-                case 4: byte4 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
-                case 3: byte3 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
-                case 2: byte2 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
-                case 1: byte1 = (uint8_t)(ch | first_byte_mark[bytes_to_write]);break;
-            }
-            switch (bytes_to_write) 
-            {
-            case 4: 
-                *target++ = (byte1);
-                *target++ = (byte2);
-                *target++ = (byte3);
-                *target++ = (byte4);
-                break;
-            case 3: 
-                *target++ = (byte1);
-                *target++ = (byte2);
-                *target++ = (byte3);
-                break;
-            case 2: 
-                *target++ = (byte1);
-                *target++ = (byte2);
-                break;
-            case 1: 
-                *target++ = (byte1);
-                break;
-            }
+    // skip_valid_utf16
+
+    template <typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf16(InputIt first, InputIt last) noexcept
+    {
+        if (first == last)
+        {
+            return first;
         }
-        return convert_result<InputIt>{first,result} ;
+        std::size_t length = static_cast<std::size_t>(last - first);
+        return advance_by(first, utf16_valid_prefix(code_units<uint16_t>(first), length));
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    template <typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf16(InputIt first, InputIt) noexcept
     {
-        conv_errc  result = conv_errc();
+        return first;
+    }
 
-        while (first != last) 
+    // Returns the length of the prefix of [data, data+length) made up of
+    // whole blocks of legal UTF-32 code units.
+    template <typename Simd>
+    std::size_t utf32_valid_prefix(const uint32_t* data, std::size_t length) noexcept
+    {
+        std::size_t pos = 0;
+        while (length - pos >= Simd::utf32_block_size && Simd::utf32_legal(data + pos))
         {
-            uint32_t ch = *first++;
-            /* If we have a surrogate pair, convert to uint32_t first. */
-            if (is_high_surrogate(ch)) 
-            {
-                /* If the 16 bits following the high surrogate are in the first buffer... */
-                if (first < last) {
-                    uint32_t ch2 = *first;
-                    /* If it's a low surrogate, */
-                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
-                        *target++ = ((uint16_t)ch);
-                        *target++ = ((uint16_t)ch2);
-                        ++first;
-                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
-                        --first; /* return to the illegal value itself */
-                        result = conv_errc::unpaired_high_surrogate;
-                        break;
-                    }
-                } else { /* We don't have the 16 bits following the high surrogate. */
-                    --first; /* return to the high surrogate */
-                    result = conv_errc::source_exhausted;
-                    break;
-                }
-            } else if (is_low_surrogate(ch)) 
-            {
-                // illegal leading low surrogate
-                if (flags == conv_flags::strict) {
-                    --first; /* return to the illegal value itself */
-                    result = conv_errc::source_illegal;
-                    break;
-                }
-                else
-                {
-                    *target++ = ((uint16_t)ch);
-                }
-            }
-            else
-            {
-                *target++ = ((uint16_t)ch);
-            }
+            pos += Simd::utf32_block_size;
         }
-        return convert_result<InputIt>{first,result} ;
+        return pos;
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    inline
+    std::size_t utf32_valid_prefix(const uint32_t* data, std::size_t length) noexcept
     {
-        conv_errc  result = conv_errc();
+#if defined(UNICONS_AVX512)
+        return utf32_valid_prefix<simd512>(data, length);
+#elif defined(UNICONS_AVX2)
+        return utf32_valid_prefix<simd256>(data, length);
+#elif defined(UNICONS_SSE42)
+        return utf32_valid_prefix<simd128>(data, length);
+#else
+        (void)data;
+        (void)length;
+        return 0;
+#endif
+    }
 
-        while (first != last) 
+    // skip_valid_utf32
+
+    template <typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf32(InputIt first, InputIt last) noexcept
+    {
+        if (first == last)
         {
-            uint32_t ch = *first++;
-            /* If we have a surrogate pair, convert to UTF32 first. */
-            if (is_high_surrogate(ch)) {
-                /* If the 16 bits following the high surrogate are in the first buffer... */
-                if (first < last) {
-                    uint32_t ch2 = *first;
-                    /* If it's a low surrogate, convert to UTF32. */
-                    if (ch2 >= sur_low_start && ch2 <= sur_low_end ) {
-                        ch = ((ch - sur_high_start) << half_shift)
-                            + (ch2 - sur_low_start) + half_base;
-                        ++first;
-                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
-                        --first; /* return to the illegal value itself */
-                        result = conv_errc::source_illegal;
-                        break;
-                    }
-                } else { /* We don't have the 16 bits following the high surrogate. */
-                    --first; /* return to the high surrogate */
-                    result = conv_errc::source_exhausted;
-                    break;
-                }
-            } else if (flags == conv_flags::strict) {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_low_surrogate(ch) ) {
-                    --first; /* return to the illegal value itself */
-                    result = conv_errc::source_illegal;
-                    break;
-                }
-            }
-            *target++ = (ch);
+            return first;
         }
-        return convert_result<InputIt>{first,result} ;
+        std::size_t length = static_cast<std::size_t>(last - first);
+        return advance_by(first, utf32_valid_prefix(code_units<uint32_t>(first), length));
     }
 
-    // utf32
+    template <typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_valid_utf32(InputIt first, InputIt) noexcept
+    {
+        return first;
+    }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    // skip_ascii
+
+    template <typename CharT>
+    bool is_ascii_unit(CharT ch) noexcept
     {
-        conv_errc  result = conv_errc();
-        while (first < last) {
-            unsigned short bytes_to_write = 0;
-            const uint32_t byteMask = 0xBF;
-            const uint32_t byteMark = 0x80; 
-            uint32_t ch = *first++;
-            if (flags == conv_flags::strict ) {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_surrogate(ch)) {
-                    --first; /* return to the illegal value itself */
-                    result = conv_errc::illegal_surrogate_value;
-                    break;
-                }
-            }
-            /*
-             * Figure out how many bytes the result will require. Turn any
-             * illegally large UTF32 things (> Plane 17) into replacement chars.
-             */
-            if (ch < (uint32_t)0x80) {      bytes_to_write = 1;
-            } else if (ch < (uint32_t)0x800) {     bytes_to_write = 2;
-            } else if (ch < (uint32_t)0x10000) {   bytes_to_write = 3;
-            } else if (ch <= max_legal_utf32) {  bytes_to_write = 4;
-            } else {                            
-                bytes_to_write = 3;
-                ch = replacement_char;
-                result = conv_errc::source_illegal;
-            }
+        return static_cast<typename std::make_unsigned<CharT>::type>(ch) < 0x80;
+    }
 
-            uint8_t byte1 = 0;
-            uint8_t byte2 = 0;
-            uint8_t byte3 = 0;
-            uint8_t byte4 = 0;
+    template <class T = void>
+    struct ascii_tables
+    {
+        // The bits of a 64-bit word that are set in a non-ASCII code unit, by code unit size
+        static constexpr uint64_t non_ascii_mask[5] = {0, 0x8080808080808080ULL, 0xFF80FF80FF80FF80ULL, 0, 0xFFFFFF80FFFFFF80ULL};
+    };
 
-            switch (bytes_to_write) {
-            case 4:
-                byte4 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
-                UNICONS_FALLTHROUGH;
-            case 3:
-                byte3 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
-                UNICONS_FALLTHROUGH;
-            case 2:
-                byte2 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
-                UNICONS_FALLTHROUGH;
-            case 1:
-                byte1 = (uint8_t) (ch | first_byte_mark[bytes_to_write]);
-            }
+    template <class T>
+    constexpr uint64_t ascii_tables<T>::non_ascii_mask[5];
 
-            switch (bytes_to_write) 
+    // Returns the length of the ASCII prefix of [data, data+length), checking
+    // a 64-bit word (8 bytes, 4 UTF-16 or 2 UTF-32 code units) at a time
+    template <typename CharT>
+    std::size_t ascii_prefix(const CharT* data, std::size_t length) noexcept
+    {
+        const std::size_t units_per_word = sizeof(uint64_t) / sizeof(CharT);
+        std::size_t i = 0;
+        while (length - i >= units_per_word)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(uint64_t));
+            if ((word & ascii_tables<>::non_ascii_mask[sizeof(CharT)]) != 0)
             {
-            case 4: 
-                *target++ = (byte1);
-                *target++ = (byte2);
-                *target++ = (byte3);
-                *target++ = (byte4);
                 break;
-            case 3: 
-                *target++ = (byte1);
-                *target++ = (byte2);
-                *target++ = (byte3);
+            }
+            i += units_per_word;
+        }
+        while (i < length && is_ascii_unit(load_unit(data + i)))
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    template <typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_ascii(InputIt first, InputIt last) noexcept
+    {
+        typedef typename std::iterator_traits<InputIt>::value_type char_type;
+        if (first == last)
+        {
+            return first;
+        }
+        return advance_by(first, ascii_prefix(code_units<char_type>(first), static_cast<std::size_t>(last - first)));
+    }
+
+    template <typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    skip_ascii(InputIt first, InputIt last) noexcept
+    {
+        while (first != last && is_ascii_unit(*first))
+        {
+            ++first;
+        }
+        return first;
+    }
+
+    // Copies, widens or narrows the run of ASCII characters at the start of [first, last)
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    InputIt copy_ascii(InputIt first, InputIt last, OutputIt& target)
+    {
+        InputIt run_last = skip_ascii(first, last);
+        for (; first != run_last; ++first)
+        {
+            *target++ = static_cast<CodeUnit>(*first);
+        }
+        return first;
+    }
+
+    // Decodes the codepoint at it and moves it past the sequence, without checking
+
+    template <typename Iterator>
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,uint32_t>::type
+    decode_valid(Iterator& it) noexcept
+    {
+        uint32_t ch = static_cast<uint8_t>(*it);
+        ++it;
+        if (ch < 0x80)
+        {
+            return ch;
+        }
+        int trailing = trailing_bytes_for_utf8[ch];
+        ch &= (0x3Fu >> trailing);
+        for (; trailing > 0; --trailing)
+        {
+            ch = (ch << 6) | (static_cast<uint8_t>(*it) & 0x3Fu);
+            ++it;
+        }
+        return ch;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char16<typename std::iterator_traits<Iterator>::value_type>::value,uint32_t>::type
+    decode_valid(Iterator& it) noexcept
+    {
+        uint32_t ch = static_cast<uint16_t>(*it);
+        ++it;
+        if (is_high_surrogate(ch))
+        {
+            uint32_t ch2 = static_cast<uint16_t>(*it);
+            ++it;
+            ch = ((ch - sur_high_start) << half_shift) + (ch2 - sur_low_start) + half_base;
+        }
+        return ch;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char32<typename std::iterator_traits<Iterator>::value_type>::value,uint32_t>::type
+    decode_valid(Iterator& it) noexcept
+    {
+        uint32_t ch = static_cast<uint32_t>(*it);
+        ++it;
+        return ch;
+    }
+
+    // The kernels decode UTF-16 and UTF-32 through code unit pointers
+
+    inline
+    uint32_t decode_valid(const uint16_t*& it) noexcept
+    {
+        uint32_t ch = load_unit(it);
+        ++it;
+        if (is_high_surrogate(ch))
+        {
+            uint32_t ch2 = load_unit(it);
+            ++it;
+            ch = ((ch - sur_high_start) << half_shift) + (ch2 - sur_low_start) + half_base;
+        }
+        return ch;
+    }
+
+    inline
+    uint32_t decode_valid(const uint32_t*& it) noexcept
+    {
+        uint32_t ch = load_unit(it);
+        ++it;
+        return ch;
+    }
+
+    // Encodes a legal codepoint
+
+    template <typename CodeUnit, typename OutputIt>
+    typename std::enable_if<sizeof(CodeUnit) == 1>::type
+    encode_valid(uint32_t ch, OutputIt& target)
+    {
+        if (ch < 0x80)
+        {
+            *target++ = static_cast<uint8_t>(ch);
+        }
+        else if (ch < 0x800)
+        {
+            *target++ = static_cast<uint8_t>(0xC0 | (ch >> 6));
+            *target++ = static_cast<uint8_t>(0x80 | (ch & 0x3F));
+        }
+        else if (ch < 0x10000)
+        {
+            *target++ = static_cast<uint8_t>(0xE0 | (ch >> 12));
+            *target++ = static_cast<uint8_t>(0x80 | ((ch >> 6) & 0x3F));
+            *target++ = static_cast<uint8_t>(0x80 | (ch & 0x3F));
+        }
+        else
+        {
+            *target++ = static_cast<uint8_t>(0xF0 | (ch >> 18));
+            *target++ = static_cast<uint8_t>(0x80 | ((ch >> 12) & 0x3F));
+            *target++ = static_cast<uint8_t>(0x80 | ((ch >> 6) & 0x3F));
+            *target++ = static_cast<uint8_t>(0x80 | (ch & 0x3F));
+        }
+    }
+
+    template <typename CodeUnit, typename OutputIt>
+    typename std::enable_if<sizeof(CodeUnit) == 2>::type
+    encode_valid(uint32_t ch, OutputIt& target)
+    {
+        if (ch < half_base)
+        {
+            *target++ = static_cast<uint16_t>(ch);
+        }
+        else
+        {
+            ch -= half_base;
+            *target++ = static_cast<uint16_t>((ch >> half_shift) + sur_high_start);
+            *target++ = static_cast<uint16_t>((ch & half_mask) + sur_low_start);
+        }
+    }
+
+    template <typename CodeUnit, typename OutputIt>
+    typename std::enable_if<sizeof(CodeUnit) == 4>::type
+    encode_valid(uint32_t ch, OutputIt& target)
+    {
+        *target++ = ch;
+    }
+
+    inline std::size_t valid_prefix(const uint8_t* data, std::size_t length) noexcept
+    {
+        return utf8_valid_prefix(data, length);
+    }
+
+    inline std::size_t valid_prefix(const uint16_t* data, std::size_t length) noexcept
+    {
+        return utf16_valid_prefix(data, length);
+    }
+
+    inline std::size_t valid_prefix(const uint32_t* data, std::size_t length) noexcept
+    {
+        return utf32_valid_prefix(data, length);
+    }
+
+    // The number of code units of size sizeof(CodeUnit) that a valid range converts to
+
+    template <typename CodeUnit>
+    std::size_t valid_length(const uint8_t* data, std::size_t length) noexcept
+    {
+        if (sizeof(CodeUnit) == 1)
+        {
+            return length;
+        }
+        // a code unit for each lead byte, and a second for each 4 byte sequence
+        std::size_t count = 0;
+        std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+        for (; length - pos >= 16; pos += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            // signed compares, ASCII bytes are greater than 0xBF and 0xEF
+            count += _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(0xBF))))));
+            if (sizeof(CodeUnit) == 2)
+            {
+                count += _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(0xEF))))
+                                                              & _mm_movemask_epi8(v)));
+            }
+        }
+#endif
+        for (; pos < length; ++pos)
+        {
+            count += is_continuation_byte(data[pos]) ? 0 : 1;
+            if (sizeof(CodeUnit) == 2)
+            {
+                count += data[pos] >= 0xF0 ? 1 : 0;
+            }
+        }
+        return count;
+    }
+
+    template <typename CodeUnit>
+    std::size_t valid_length(const uint16_t* data, std::size_t length) noexcept
+    {
+        if (sizeof(CodeUnit) == 2)
+        {
+            return length;
+        }
+        // UTF-8 takes 1, 2 or 3 bytes for each code unit, 2 for each surrogate, 
+        // UTF-32 a code unit for each but low surrogates
+        std::size_t count = 0;
+        std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+        for (; length - pos >= 8; pos += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            // two mask bits for each code unit
+            if (sizeof(CodeUnit) == 1)
+            {
+                const unsigned ascii = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128())));
+                const unsigned two = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_setzero_si128())));
+                const unsigned surrogate = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xF800))), 
+                                                                                                 _mm_set1_epi16(static_cast<short>(0xD800)))));
+                count += 24 - (_mm_popcnt_u32(ascii) + _mm_popcnt_u32(two) + _mm_popcnt_u32(surrogate)) / 2;
+            }
+            else
+            {
+                const unsigned low = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFC00))), 
+                                                                                           _mm_set1_epi16(static_cast<short>(0xDC00)))));
+                count += 8 - _mm_popcnt_u32(low) / 2;
+            }
+        }
+#endif
+        for (; pos < length; ++pos)
+        {
+            const uint16_t ch = load_unit(data + pos);
+            if (sizeof(CodeUnit) == 1)
+            {
+                count += ch < 0x80 ? 1 : (ch < 0x800 || is_surrogate(ch)) ? 2 : 3;
+            }
+            else
+            {
+                count += is_low_surrogate(ch) ? 0 : 1;
+            }
+        }
+        return count;
+    }
+
+    template <typename CodeUnit>
+    std::size_t valid_length(const uint32_t* data, std::size_t length) noexcept
+    {
+        if (sizeof(CodeUnit) == 4)
+        {
+            return length;
+        }
+        std::size_t count = 0;
+        std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+        for (; length - pos >= 4; pos += 4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            count += 4 + _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(0xFFFF))))));
+            if (sizeof(CodeUnit) == 1)
+            {
+                count += _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(0x7F))))));
+                count += _mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(0x7FF))))));
+            }
+        }
+#endif
+        for (; pos < length; ++pos)
+        {
+            const uint32_t ch = load_unit(data + pos);
+            if (sizeof(CodeUnit) == 1)
+            {
+                count += ch < 0x80 ? 1 : ch < 0x800 ? 2 : ch < 0x10000 ? 3 : 4;
+            }
+            else
+            {
+                count += ch < 0x10000 ? 1 : 2;
+            }
+        }
+        return count;
+    }
+
+    // transcode_prefix
+
+    template <typename OutputIt, typename CodeUnit, typename Enable=void>
+    struct is_code_unit_pointer : std::false_type {};
+
+    template <typename T, typename CodeUnit>
+    struct is_code_unit_pointer<T*, CodeUnit, typename std::enable_if<!std::is_const<T>::value && is_character<T>::value>::type>
+        : is_same_size<T,CodeUnit> {};
+
+    constexpr std::size_t transcode_chunk_size = 1 << 16;
+    constexpr std::size_t transcode_buffer_size = 1024;
+
+    // Transcodes the valid prefix of a contiguous range with a kernel, SIMD or,
+    // without SIMD, one for the ASCII prefix, a chunk at a time, so that 
+    // validation and transcoding of a chunk share the cache. The rest of the 
+    // range, including the first error if any, is left to the scalar code. 
+    // A Kernel provides
+    //
+    //     source_type, target_type
+    //     max_expansion: target code units per source code unit
+    //     valid_prefix(const source_type*, std::size_t): the length of a valid prefix 
+    //         that ends on a sequence boundary
+    //     transcode(const source_type*, std::size_t, T* target): transcodes a valid
+    //         range, returning the end of the output
+    //
+    // and optionally output_length(const source_type*, std::size_t), the number of
+    // target code units for a valid range, if it is not that of the UTF encoding 
+    // of the target.
+
+    template <typename Kernel, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value && 
+                            is_code_unit_pointer<OutputIt,typename Kernel::target_type>::value,InputIt>::type
+    transcode_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        if (first == last)
+        {
+            return first;
+        }
+        const typename Kernel::source_type* data = code_units<typename Kernel::source_type>(first);
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        std::size_t pos = 0;
+        for (;;)
+        {
+            std::size_t n = Kernel::valid_prefix(data + pos, (std::min)(length - pos, transcode_chunk_size));
+            if (n == 0)
+            {
                 break;
-            case 2: 
-                *target++ = (byte1);
-                *target++ = (byte2);
+            }
+            target = Kernel::transcode(data + pos, n, target);
+            pos += n;
+        }
+        return advance_by(first, pos);
+    }
+
+    // A back_insert_iterator into a std::basic_string or std::vector of code units 
+    // grows its container by the exact length of each chunk, and is written through
+    // a pointer
+
+    template <typename OutputIt, typename CodeUnit, typename Enable=void>
+    struct is_contiguous_back_inserter : std::false_type {};
+
+    template <typename CharT, typename Traits, typename Allocator, typename CodeUnit>
+    struct is_contiguous_back_inserter<std::back_insert_iterator<std::basic_string<CharT,Traits,Allocator>>, CodeUnit, 
+                                       typename std::enable_if<is_character<CharT>::value>::type>
+        : is_same_size<CharT,CodeUnit> {};
+
+    template <typename CharT, typename Allocator, typename CodeUnit>
+    struct is_contiguous_back_inserter<std::back_insert_iterator<std::vector<CharT,Allocator>>, CodeUnit, 
+                                       typename std::enable_if<is_character<CharT>::value>::type>
+        : is_same_size<CharT,CodeUnit> {};
+
+    // The number of target code units for a valid range
+
+    template <typename Kernel, typename Enable=void>
+    struct has_output_length : std::false_type {};
+
+    template <typename Kernel>
+    struct has_output_length<Kernel,
+        typename std::enable_if<std::is_same<decltype(Kernel::output_length(std::declval<const typename Kernel::source_type*>(), std::size_t())),std::size_t>::value>::type>
+        : std::true_type {};
+
+    template <typename Kernel>
+    typename std::enable_if<has_output_length<Kernel>::value,std::size_t>::type
+    kernel_output_length(const typename Kernel::source_type* data, std::size_t length) noexcept
+    {
+        return Kernel::output_length(data, length);
+    }
+
+    template <typename Kernel>
+    typename std::enable_if<!has_output_length<Kernel>::value,std::size_t>::type
+    kernel_output_length(const typename Kernel::source_type* data, std::size_t length) noexcept
+    {
+        return valid_length<typename Kernel::target_type>(data, length);
+    }
+
+    // back_insert_iterator keeps its container in a protected member
+    template <typename Container>
+    struct back_insert_container : std::back_insert_iterator<Container>
+    {
+        static Container& get(std::back_insert_iterator<Container>& it) noexcept
+        {
+            return *(it.*(&back_insert_container::container));
+        }
+    };
+
+    template <typename String, typename Enable=void>
+    struct has_resize_and_overwrite : std::false_type {};
+
+    template <typename String>
+    struct has_resize_and_overwrite<String,void_t<decltype(std::declval<String&>().resize_and_overwrite(std::size_t(), 
+        std::declval<std::size_t(*)(typename String::value_type*, std::size_t)>()))>> : std::true_type {};
+
+    // Grows a container by length code units and transcodes a valid range into
+    // them, without filling them first where the standard library allows
+    template <typename Kernel, typename Container>
+    typename std::enable_if<has_resize_and_overwrite<Container>::value>::type
+    append_transcoded(Container& container, std::size_t length, const typename Kernel::source_type* data, std::size_t n)
+    {
+        const std::size_t size = container.size();
+        container.resize_and_overwrite(size + length, [&](typename Container::value_type* p, std::size_t)
+        {
+            Kernel::transcode(data, n, p + size);
+            return size + length;
+        });
+    }
+
+    template <typename Kernel, typename Container>
+    typename std::enable_if<!has_resize_and_overwrite<Container>::value>::type
+    append_transcoded(Container& container, std::size_t length, const typename Kernel::source_type* data, std::size_t n)
+    {
+        const std::size_t size = container.size();
+        container.resize(size + length);
+        Kernel::transcode(data, n, std::addressof(container[0]) + size);
+    }
+
+    template <typename Kernel, typename InputIt, typename Container>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value && 
+                            is_contiguous_back_inserter<std::back_insert_iterator<Container>,typename Kernel::target_type>::value,InputIt>::type
+    transcode_prefix(InputIt first, InputIt last, std::back_insert_iterator<Container>& target)
+    {
+        if (first == last)
+        {
+            return first;
+        }
+        Container& container = back_insert_container<Container>::get(target);
+        const typename Kernel::source_type* data = code_units<typename Kernel::source_type>(first);
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        std::size_t pos = 0;
+        for (;;)
+        {
+            std::size_t n = Kernel::valid_prefix(data + pos, (std::min)(length - pos, transcode_chunk_size));
+            if (n == 0)
+            {
                 break;
-            case 1: 
-                *target++ = (byte1);
+            }
+            append_transcoded<Kernel>(container, kernel_output_length<Kernel>(data + pos, n), data + pos, n);
+            pos += n;
+        }
+        return advance_by(first, pos);
+    }
+
+    // Other output iterators are written from a buffer on the stack
+    template <typename Kernel, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value && 
+                            !is_code_unit_pointer<OutputIt,typename Kernel::target_type>::value &&
+                            !is_contiguous_back_inserter<OutputIt,typename Kernel::target_type>::value,InputIt>::type
+    transcode_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        if (first == last)
+        {
+            return first;
+        }
+        const typename Kernel::source_type* data = code_units<typename Kernel::source_type>(first);
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        typename Kernel::target_type buffer[transcode_buffer_size];
+        std::size_t pos = 0;
+        for (;;)
+        {
+            std::size_t n = Kernel::valid_prefix(data + pos, (std::min)(length - pos, transcode_buffer_size / Kernel::max_expansion));
+            if (n == 0)
+            {
                 break;
             }
+            typename Kernel::target_type* end = Kernel::transcode(data + pos, n, buffer);
+            target = std::copy(buffer, end, target);
+            pos += n;
         }
-        return convert_result<InputIt>{first,result} ;
+        return advance_by(first, pos);
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    template <typename Kernel, typename InputIt, typename OutputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    transcode_prefix(InputIt first, InputIt, OutputIt&)
+    {
+        return first;
+    }
+
+    // A std::ostreambuf_iterator target is written through a block of code units 
+    // on the stack, by the SIMD kernels and the scalar code alike. Each full block, 
+    // and the rest at the end, is flushed to the iterator with std::copy.
+
+    constexpr std::size_t ostreambuf_block_bytes = 4096;
+
+    template <typename CharT, typename Traits>
+    class ostreambuf_block
+    {
+    public:
+        typedef std::ostreambuf_iterator<CharT,Traits> iterator_type;
+        static constexpr std::size_t capacity = ostreambuf_block_bytes / sizeof(CharT);
+
+        explicit ostreambuf_block(iterator_type target) noexcept
+            : target_(target), size_(0)
+        {
+        }
+
+        ostreambuf_block(const ostreambuf_block&) = delete;
+        ostreambuf_block& operator=(const ostreambuf_block&) = delete;
+
+        void put(CharT c)
+        {
+            if (size_ == capacity)
+            {
+                flush();
+            }
+            data_[size_++] = c;
+        }
+
+        // Room for at least length code units, to be written directly and then committed
+        CharT* reserve(std::size_t length)
+        {
+            if (capacity - size_ < length)
+            {
+                flush();
+            }
+            return data_ + size_;
+        }
+
+        void commit(CharT* end) noexcept
+        {
+            size_ = static_cast<std::size_t>(end - data_);
+        }
+
+        // Once the iterator has failed, nothing more is written to it
+        iterator_type flush()
+        {
+            if (size_ > 0 && !target_.failed())
+            {
+                target_ = std::copy(data_, data_ + size_, target_);
+            }
+            size_ = 0;
+            return target_;
+        }
+    private:
+        iterator_type target_;
+        std::size_t size_;
+        CharT data_[capacity];
+    };
+
+    template <typename CharT, typename Traits>
+    class ostreambuf_inserter
+    {
+    public:
+        typedef std::output_iterator_tag iterator_category;
+        typedef void value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef void reference;
+        typedef CharT char_type;
+        typedef Traits traits_type;
+
+        explicit ostreambuf_inserter(ostreambuf_block<CharT,Traits>& block) noexcept
+            : block_(std::addressof(block))
+        {
+        }
+
+        ostreambuf_inserter& operator=(CharT c)
+        {
+            block_->put(c);
+            return *this;
+        }
+
+        ostreambuf_inserter& operator*() noexcept
+        {
+            return *this;
+        }
+
+        ostreambuf_inserter& operator++() noexcept
+        {
+            return *this;
+        }
+
+        ostreambuf_inserter& operator++(int) noexcept
+        {
+            return *this;
+        }
+
+        ostreambuf_block<CharT,Traits>& block() const noexcept
+        {
+            return *block_;
+        }
+    private:
+        ostreambuf_block<CharT,Traits>* block_;
+    };
+
+    template <typename Kernel, typename InputIt, typename CharT, typename Traits>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    transcode_prefix(InputIt first, InputIt last, ostreambuf_inserter<CharT,Traits>& target)
+    {
+        if (first == last)
+        {
+            return first;
+        }
+        const typename Kernel::source_type* data = code_units<typename Kernel::source_type>(first);
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        std::size_t pos = 0;
+        for (;;)
+        {
+            std::size_t n = Kernel::valid_prefix(data + pos, (std::min)(length - pos, transcode_buffer_size / Kernel::max_expansion));
+            if (n == 0)
+            {
+                break;
+            }
+            CharT* out = target.block().reserve(n*Kernel::max_expansion);
+            target.block().commit(Kernel::transcode(data + pos, n, out));
+            pos += n;
+        }
+        return advance_by(first, pos);
+    }
+
+#if defined(UNICONS_SSE42)
+
+    template <class T = void>
+    struct lane_tables
+    {
+        // Lane indices that pack the 16-bit lanes selected by an 8-bit mask to the front
+        static constexpr uint8_t pack_epi16_lanes[256][8] = {
+            {0,0,0,0,0,0,0,0},{0,0,0,0,0,0,0,0},{1,0,0,0,0,0,0,0},{0,1,0,0,0,0,0,0},
+            {2,0,0,0,0,0,0,0},{0,2,0,0,0,0,0,0},{1,2,0,0,0,0,0,0},{0,1,2,0,0,0,0,0},
+            {3,0,0,0,0,0,0,0},{0,3,0,0,0,0,0,0},{1,3,0,0,0,0,0,0},{0,1,3,0,0,0,0,0},
+            {2,3,0,0,0,0,0,0},{0,2,3,0,0,0,0,0},{1,2,3,0,0,0,0,0},{0,1,2,3,0,0,0,0},
+            {4,0,0,0,0,0,0,0},{0,4,0,0,0,0,0,0},{1,4,0,0,0,0,0,0},{0,1,4,0,0,0,0,0},
+            {2,4,0,0,0,0,0,0},{0,2,4,0,0,0,0,0},{1,2,4,0,0,0,0,0},{0,1,2,4,0,0,0,0},
+            {3,4,0,0,0,0,0,0},{0,3,4,0,0,0,0,0},{1,3,4,0,0,0,0,0},{0,1,3,4,0,0,0,0},
+            {2,3,4,0,0,0,0,0},{0,2,3,4,0,0,0,0},{1,2,3,4,0,0,0,0},{0,1,2,3,4,0,0,0},
+            {5,0,0,0,0,0,0,0},{0,5,0,0,0,0,0,0},{1,5,0,0,0,0,0,0},{0,1,5,0,0,0,0,0},
+            {2,5,0,0,0,0,0,0},{0,2,5,0,0,0,0,0},{1,2,5,0,0,0,0,0},{0,1,2,5,0,0,0,0},
+            {3,5,0,0,0,0,0,0},{0,3,5,0,0,0,0,0},{1,3,5,0,0,0,0,0},{0,1,3,5,0,0,0,0},
+            {2,3,5,0,0,0,0,0},{0,2,3,5,0,0,0,0},{1,2,3,5,0,0,0,0},{0,1,2,3,5,0,0,0},
+            {4,5,0,0,0,0,0,0},{0,4,5,0,0,0,0,0},{1,4,5,0,0,0,0,0},{0,1,4,5,0,0,0,0},
+            {2,4,5,0,0,0,0,0},{0,2,4,5,0,0,0,0},{1,2,4,5,0,0,0,0},{0,1,2,4,5,0,0,0},
+            {3,4,5,0,0,0,0,0},{0,3,4,5,0,0,0,0},{1,3,4,5,0,0,0,0},{0,1,3,4,5,0,0,0},
+            {2,3,4,5,0,0,0,0},{0,2,3,4,5,0,0,0},{1,2,3,4,5,0,0,0},{0,1,2,3,4,5,0,0},
+            {6,0,0,0,0,0,0,0},{0,6,0,0,0,0,0,0},{1,6,0,0,0,0,0,0},{0,1,6,0,0,0,0,0},
+            {2,6,0,0,0,0,0,0},{0,2,6,0,0,0,0,0},{1,2,6,0,0,0,0,0},{0,1,2,6,0,0,0,0},
+            {3,6,0,0,0,0,0,0},{0,3,6,0,0,0,0,0},{1,3,6,0,0,0,0,0},{0,1,3,6,0,0,0,0},
+            {2,3,6,0,0,0,0,0},{0,2,3,6,0,0,0,0},{1,2,3,6,0,0,0,0},{0,1,2,3,6,0,0,0},
+            {4,6,0,0,0,0,0,0},{0,4,6,0,0,0,0,0},{1,4,6,0,0,0,0,0},{0,1,4,6,0,0,0,0},
+            {2,4,6,0,0,0,0,0},{0,2,4,6,0,0,0,0},{1,2,4,6,0,0,0,0},{0,1,2,4,6,0,0,0},
+            {3,4,6,0,0,0,0,0},{0,3,4,6,0,0,0,0},{1,3,4,6,0,0,0,0},{0,1,3,4,6,0,0,0},
+            {2,3,4,6,0,0,0,0},{0,2,3,4,6,0,0,0},{1,2,3,4,6,0,0,0},{0,1,2,3,4,6,0,0},
+            {5,6,0,0,0,0,0,0},{0,5,6,0,0,0,0,0},{1,5,6,0,0,0,0,0},{0,1,5,6,0,0,0,0},
+            {2,5,6,0,0,0,0,0},{0,2,5,6,0,0,0,0},{1,2,5,6,0,0,0,0},{0,1,2,5,6,0,0,0},
+            {3,5,6,0,0,0,0,0},{0,3,5,6,0,0,0,0},{1,3,5,6,0,0,0,0},{0,1,3,5,6,0,0,0},
+            {2,3,5,6,0,0,0,0},{0,2,3,5,6,0,0,0},{1,2,3,5,6,0,0,0},{0,1,2,3,5,6,0,0},
+            {4,5,6,0,0,0,0,0},{0,4,5,6,0,0,0,0},{1,4,5,6,0,0,0,0},{0,1,4,5,6,0,0,0},
+            {2,4,5,6,0,0,0,0},{0,2,4,5,6,0,0,0},{1,2,4,5,6,0,0,0},{0,1,2,4,5,6,0,0},
+            {3,4,5,6,0,0,0,0},{0,3,4,5,6,0,0,0},{1,3,4,5,6,0,0,0},{0,1,3,4,5,6,0,0},
+            {2,3,4,5,6,0,0,0},{0,2,3,4,5,6,0,0},{1,2,3,4,5,6,0,0},{0,1,2,3,4,5,6,0},
+            {7,0,0,0,0,0,0,0},{0,7,0,0,0,0,0,0},{1,7,0,0,0,0,0,0},{0,1,7,0,0,0,0,0},
+            {2,7,0,0,0,0,0,0},{0,2,7,0,0,0,0,0},{1,2,7,0,0,0,0,0},{0,1,2,7,0,0,0,0},
+            {3,7,0,0,0,0,0,0},{0,3,7,0,0,0,0,0},{1,3,7,0,0,0,0,0},{0,1,3,7,0,0,0,0},
+            {2,3,7,0,0,0,0,0},{0,2,3,7,0,0,0,0},{1,2,3,7,0,0,0,0},{0,1,2,3,7,0,0,0},
+            {4,7,0,0,0,0,0,0},{0,4,7,0,0,0,0,0},{1,4,7,0,0,0,0,0},{0,1,4,7,0,0,0,0},
+            {2,4,7,0,0,0,0,0},{0,2,4,7,0,0,0,0},{1,2,4,7,0,0,0,0},{0,1,2,4,7,0,0,0},
+            {3,4,7,0,0,0,0,0},{0,3,4,7,0,0,0,0},{1,3,4,7,0,0,0,0},{0,1,3,4,7,0,0,0},
+            {2,3,4,7,0,0,0,0},{0,2,3,4,7,0,0,0},{1,2,3,4,7,0,0,0},{0,1,2,3,4,7,0,0},
+            {5,7,0,0,0,0,0,0},{0,5,7,0,0,0,0,0},{1,5,7,0,0,0,0,0},{0,1,5,7,0,0,0,0},
+            {2,5,7,0,0,0,0,0},{0,2,5,7,0,0,0,0},{1,2,5,7,0,0,0,0},{0,1,2,5,7,0,0,0},
+            {3,5,7,0,0,0,0,0},{0,3,5,7,0,0,0,0},{1,3,5,7,0,0,0,0},{0,1,3,5,7,0,0,0},
+            {2,3,5,7,0,0,0,0},{0,2,3,5,7,0,0,0},{1,2,3,5,7,0,0,0},{0,1,2,3,5,7,0,0},
+            {4,5,7,0,0,0,0,0},{0,4,5,7,0,0,0,0},{1,4,5,7,0,0,0,0},{0,1,4,5,7,0,0,0},
+            {2,4,5,7,0,0,0,0},{0,2,4,5,7,0,0,0},{1,2,4,5,7,0,0,0},{0,1,2,4,5,7,0,0},
+            {3,4,5,7,0,0,0,0},{0,3,4,5,7,0,0,0},{1,3,4,5,7,0,0,0},{0,1,3,4,5,7,0,0},
+            {2,3,4,5,7,0,0,0},{0,2,3,4,5,7,0,0},{1,2,3,4,5,7,0,0},{0,1,2,3,4,5,7,0},
+            {6,7,0,0,0,0,0,0},{0,6,7,0,0,0,0,0},{1,6,7,0,0,0,0,0},{0,1,6,7,0,0,0,0},
+            {2,6,7,0,0,0,0,0},{0,2,6,7,0,0,0,0},{1,2,6,7,0,0,0,0},{0,1,2,6,7,0,0,0},
+            {3,6,7,0,0,0,0,0},{0,3,6,7,0,0,0,0},{1,3,6,7,0,0,0,0},{0,1,3,6,7,0,0,0},
+            {2,3,6,7,0,0,0,0},{0,2,3,6,7,0,0,0},{1,2,3,6,7,0,0,0},{0,1,2,3,6,7,0,0},
+            {4,6,7,0,0,0,0,0},{0,4,6,7,0,0,0,0},{1,4,6,7,0,0,0,0},{0,1,4,6,7,0,0,0},
+            {2,4,6,7,0,0,0,0},{0,2,4,6,7,0,0,0},{1,2,4,6,7,0,0,0},{0,1,2,4,6,7,0,0},
+            {3,4,6,7,0,0,0,0},{0,3,4,6,7,0,0,0},{1,3,4,6,7,0,0,0},{0,1,3,4,6,7,0,0},
+            {2,3,4,6,7,0,0,0},{0,2,3,4,6,7,0,0},{1,2,3,4,6,7,0,0},{0,1,2,3,4,6,7,0},
+            {5,6,7,0,0,0,0,0},{0,5,6,7,0,0,0,0},{1,5,6,7,0,0,0,0},{0,1,5,6,7,0,0,0},
+            {2,5,6,7,0,0,0,0},{0,2,5,6,7,0,0,0},{1,2,5,6,7,0,0,0},{0,1,2,5,6,7,0,0},
+            {3,5,6,7,0,0,0,0},{0,3,5,6,7,0,0,0},{1,3,5,6,7,0,0,0},{0,1,3,5,6,7,0,0},
+            {2,3,5,6,7,0,0,0},{0,2,3,5,6,7,0,0},{1,2,3,5,6,7,0,0},{0,1,2,3,5,6,7,0},
+            {4,5,6,7,0,0,0,0},{0,4,5,6,7,0,0,0},{1,4,5,6,7,0,0,0},{0,1,4,5,6,7,0,0},
+            {2,4,5,6,7,0,0,0},{0,2,4,5,6,7,0,0},{1,2,4,5,6,7,0,0},{0,1,2,4,5,6,7,0},
+            {3,4,5,6,7,0,0,0},{0,3,4,5,6,7,0,0},{1,3,4,5,6,7,0,0},{0,1,3,4,5,6,7,0},
+            {2,3,4,5,6,7,0,0},{0,2,3,4,5,6,7,0},{1,2,3,4,5,6,7,0},{0,1,2,3,4,5,6,7}
+        };
+    };
+
+    template <class T>
+    constexpr uint8_t lane_tables<T>::pack_epi16_lanes[256][8];
+
+    // Packs the 16-bit lanes of values selected by mask to the front
+    inline __m128i pack_epi16(__m128i values, unsigned mask) noexcept
+    {
+        __m128i lanes = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lane_tables<>::pack_epi16_lanes[mask])));
+        __m128i control = _mm_add_epi16(_mm_mullo_epi16(lanes, _mm_set1_epi16(0x0202)), _mm_set1_epi16(0x0100));
+        return _mm_shuffle_epi8(values, control);
+    }
+
+    // Stores 16 ASCII bytes as UTF-8, UTF-16 or UTF-32 code units
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 1,T*>::type
+    store_ascii(__m128i input, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), input);
+        return target + 16;
+    }
+
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 2,T*>::type
+    store_ascii(__m128i input, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_cvtepu8_epi16(input));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), _mm_cvtepu8_epi16(_mm_srli_si128(input, 8)));
+        return target + 16;
+    }
+
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 4,T*>::type
+    store_ascii(__m128i input, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_cvtepu8_epi32(input));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 4), _mm_cvtepu8_epi32(_mm_srli_si128(input, 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), _mm_cvtepu8_epi32(_mm_srli_si128(input, 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 12), _mm_cvtepu8_epi32(_mm_srli_si128(input, 12)));
+        return target + 16;
+    }
+
+    // Stores the first count of 8 BMP codepoints in 16-bit lanes, writing all 8 lanes
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 2,T*>::type
+    store_bmp(__m128i values, unsigned count, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), values);
+        return target + count;
+    }
+
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 4,T*>::type
+    store_bmp(__m128i values, unsigned count, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_cvtepu16_epi32(values));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 4), _mm_cvtepu16_epi32(_mm_srli_si128(values, 8)));
+        return target + count;
+    }
+
+    // Stores 4 supplementary codepoints in 32-bit lanes, as surrogate pairs or as they are
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 2,T*>::type
+    store_supplementary(__m128i cp, T* target) noexcept
+    {
+        cp = _mm_sub_epi32(cp, _mm_set1_epi32(static_cast<int>(half_base)));
+        const __m128i high = _mm_add_epi32(_mm_srli_epi32(cp, half_shift), _mm_set1_epi32(static_cast<int>(sur_high_start)));
+        const __m128i low = _mm_add_epi32(_mm_and_si128(cp, _mm_set1_epi32(static_cast<int>(half_mask))), _mm_set1_epi32(static_cast<int>(sur_low_start)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_or_si128(high, _mm_slli_epi32(low, 16)));
+        return target + 8;
+    }
+
+    template <typename T>
+    typename std::enable_if<sizeof(T) == 4,T*>::type
+    store_supplementary(__m128i cp, T* target) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), cp);
+        return target + 4;
+    }
+
+    /*
+     * UTF-8 to UTF-16 or UTF-32 for valid input, 16 bytes at a time, with a 
+     * path for each kind of block:
+     *  - ASCII: the bytes are widened.
+     *  - 1 to 3 byte sequences: each lane is decoded as if it were the lead
+     *    of a sequence, from the byte and the two bytes that follow it, then
+     *    the lanes of the leads are packed. Blocks without 3 byte sequences
+     *    skip the third byte.
+     *  - four 4 byte sequences: each 32-bit lane is decoded to a codepoint.
+     * Other blocks are decoded a sequence at a time.
+     */
+    template <typename CodeUnit>
+    struct utf8_decode_kernel
+    {
+        typedef uint8_t source_type;
+        typedef CodeUnit target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const uint8_t* data, std::size_t length) noexcept
+        {
+            return utf8_valid_prefix(data, length);
+        }
+
+        // Decodes 8 lanes, each as if it were the lead of a sequence of up to three bytes
+        template <bool ThreeByte>
+        static __m128i decode_lanes(__m128i input, __m128i next1, __m128i next2) noexcept
+        {
+            const __m128i b = _mm_cvtepu8_epi16(input);
+            const __m128i c1 = _mm_and_si128(_mm_cvtepu8_epi16(next1), _mm_set1_epi16(0x3F));
+            __m128i result = _mm_blendv_epi8(b, _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x1F)), 6), c1),
+                                             _mm_cmpgt_epi16(b, _mm_set1_epi16(0x7F)));
+            if (ThreeByte)
+            {
+                const __m128i c2 = _mm_and_si128(_mm_cvtepu8_epi16(next2), _mm_set1_epi16(0x3F));
+                const __m128i three = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(b, 12), _mm_slli_epi16(c1, 6)), c2);
+                result = _mm_blendv_epi8(result, three, _mm_cmpgt_epi16(b, _mm_set1_epi16(0xDF)));
+            }
+            return result;
+        }
+
+        template <bool ThreeByte, typename T>
+        static T* decode_block(__m128i input, __m128i next1, __m128i next2, unsigned leads, T* target) noexcept
+        {
+            target = store_bmp(pack_epi16(decode_lanes<ThreeByte>(input, next1, next2), leads & 0xFF), 
+                               _mm_popcnt_u32(leads & 0xFF), target);
+            return store_bmp(pack_epi16(decode_lanes<ThreeByte>(_mm_srli_si128(input, 8), _mm_srli_si128(next1, 8), _mm_srli_si128(next2, 8)), leads >> 8), 
+                             _mm_popcnt_u32(leads >> 8), target);
+        }
+
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+            // A block stores 8 lanes at a time, some of which may be past its output.
+            // 48 more bytes give at least 12 more code units to overwrite them.
+            while (length - pos >= 64)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                if (_mm_movemask_epi8(input) == 0)
+                {
+                    target = store_ascii(input, target);
+                    pos += 16;
+                    continue;
+                }
+                // continuation bytes are 0x80 to 0xBF, less than 0xC0 as signed bytes
+                const unsigned leads = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(input, _mm_set1_epi8(static_cast<char>(0xC0))))) & 0xFFFF;
+                const unsigned four_byte = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(input, _mm_set1_epi8(static_cast<char>(0xF0))), input)));
+                if (four_byte == 0)
+                {
+                    const __m128i next1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1));
+                    const __m128i next2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 2));
+                    const unsigned three_byte = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(input, _mm_set1_epi8(static_cast<char>(0xE0))), input)));
+                    target = three_byte == 0 ? decode_block<false>(input, next1, next2, leads, target)
+                                             : decode_block<true>(input, next1, next2, leads, target);
+                    // the last sequence may end in the two bytes after the block
+                    pos += 16;
+                    if (is_continuation_byte(data[pos]))
+                    {
+                        pos += is_continuation_byte(data[pos + 1]) ? 2 : 1;
+                    }
+                }
+                else if (leads == 0x1111)
+                {
+                    const __m128i x = input;
+                    const __m128i cp = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x07)), 18),
+                                                                 _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x3F00)), 4)),
+                                                    _mm_or_si128(_mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x3F0000)), 10),
+                                                                 _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x3F000000)), 24)));
+                    target = store_supplementary(cp, target);
+                    pos += 16;
+                }
+                else
+                {
+                    const uint8_t* p = data + pos;
+                    const uint8_t* block_end = p + 16;
+                    while (p < block_end)
+                    {
+                        encode_valid<CodeUnit>(decode_valid(p), target);
+                    }
+                    pos = static_cast<std::size_t>(p - data);
+                }
+            }
+            const uint8_t* p = data + pos;
+            const uint8_t* end = data + length;
+            while (p != end)
+            {
+                encode_valid<CodeUnit>(decode_valid(p), target);
+            }
+            return target;
+        }
+    };
+
+    // Packs the bytes of values selected by a 16-bit mask to the front and 
+    // stores them, writing 8 bytes for each half of the mask
+    template <typename T>
+    T* store_packed_epi8(__m128i values, unsigned mask, T* target) noexcept
+    {
+        const __m128i low = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(lane_tables<>::pack_epi16_lanes[mask & 0xFF]));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_shuffle_epi8(values, low));
+        target += _mm_popcnt_u32(mask & 0xFF);
+        const __m128i high = _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lane_tables<>::pack_epi16_lanes[mask >> 8])), _mm_set1_epi8(8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_shuffle_epi8(values, high));
+        return target + _mm_popcnt_u32(mask >> 8);
+    }
+
+    // Encodes 8 codepoints less than 0x800 in 16-bit lanes as UTF-8
+    template <typename T>
+    T* encode_utf8_epi16(__m128i ch, T* target) noexcept
+    {
+        const __m128i two = _mm_cmpgt_epi16(ch, _mm_set1_epi16(0x7F));
+        const __m128i c1 = _mm_or_si128(_mm_and_si128(ch, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+        const __m128i bytes = _mm_blendv_epi8(ch, _mm_or_si128(_mm_or_si128(_mm_srli_epi16(ch, 6), _mm_set1_epi16(0xC0)), _mm_slli_epi16(c1, 8)), two);
+        const __m128i keep = _mm_or_si128(_mm_set1_epi16(0xFF), _mm_slli_epi16(two, 8));
+        return store_packed_epi8(bytes, static_cast<unsigned>(_mm_movemask_epi8(keep)), target);
+    }
+
+    // Encodes 4 BMP codepoints in 32-bit lanes as UTF-8
+    template <typename T>
+    T* encode_utf8_epi32(__m128i ch, T* target) noexcept
+    {
+        const __m128i two = _mm_cmpgt_epi32(ch, _mm_set1_epi32(0x7F));
+        const __m128i three = _mm_cmpgt_epi32(ch, _mm_set1_epi32(0x7FF));
+        const __m128i c1 = _mm_or_si128(_mm_and_si128(ch, _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80));
+        const __m128i c2 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(ch, 6), _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80));
+        __m128i bytes = _mm_blendv_epi8(ch, _mm_or_si128(_mm_or_si128(_mm_srli_epi32(ch, 6), _mm_set1_epi32(0xC0)), _mm_slli_epi32(c1, 8)), two);
+        bytes = _mm_blendv_epi8(bytes, _mm_or_si128(_mm_or_si128(_mm_srli_epi32(ch, 12), _mm_set1_epi32(0xE0)), 
+                                                    _mm_or_si128(_mm_slli_epi32(c2, 8), _mm_slli_epi32(c1, 16))), three);
+        const __m128i keep = _mm_or_si128(_mm_or_si128(_mm_set1_epi32(0xFF), _mm_and_si128(two, _mm_set1_epi32(0xFF00))),
+                                          _mm_and_si128(three, _mm_set1_epi32(0xFF0000)));
+        return store_packed_epi8(bytes, static_cast<unsigned>(_mm_movemask_epi8(keep)), target);
+    }
+
+    // Encodes 4 supplementary codepoints in 32-bit lanes as UTF-8
+    template <typename T>
+    T* encode_utf8_supplementary(__m128i cp, T* target) noexcept
+    {
+        const __m128i b0 = _mm_or_si128(_mm_srli_epi32(cp, 18), _mm_set1_epi32(0xF0));
+        const __m128i b1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(cp, 12), _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80));
+        const __m128i b2 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(cp, 6), _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80));
+        const __m128i b3 = _mm_or_si128(_mm_and_si128(cp, _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), 
+                         _mm_or_si128(_mm_or_si128(b0, _mm_slli_epi32(b1, 8)), _mm_or_si128(_mm_slli_epi32(b2, 16), _mm_slli_epi32(b3, 24))));
+        return target + 16;
+    }
+
+    /*
+     * UTF-16 to UTF-8 or UTF-32 for valid input, 8 code units at a time. 
+     */
+    template <typename CodeUnit>
+    struct utf16_transcode_kernel;
+
+    /*
+     * To UTF-8, with a path for each kind of block:
+     *  - ASCII: the code units are narrowed.
+     *  - 1 and 2 byte sequences: each 16-bit lane is encoded in place, and 
+     *    the second byte of ASCII lanes is packed out.
+     *  - 1 to 3 byte sequences: each codepoint is widened to a 32-bit lane
+     *    and encoded in place, and the unused bytes are packed out.
+     *  - four surrogate pairs: each 32-bit lane is encoded to 4 bytes.
+     * Other blocks are encoded a codepoint at a time.
+     */
+    template <>
+    struct utf16_transcode_kernel<uint8_t>
+    {
+        typedef uint16_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 3;
+
+        static std::size_t valid_prefix(const uint16_t* data, std::size_t length) noexcept
+        {
+            return utf16_valid_prefix(data, length);
+        }
+
+        template <typename T>
+        static T* transcode(const uint16_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+            // A block stores 8 bytes at a time, some of which may be past its output.
+            // 8 more code units give at least 8 more bytes to overwrite them.
+            while (length - pos >= 16)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                if (_mm_testz_si128(input, _mm_set1_epi16(static_cast<short>(0xFF80))))
+                {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(input, input));
+                    target += 8;
+                }
+                else if (_mm_testz_si128(input, _mm_set1_epi16(static_cast<short>(0xF800))))
+                {
+                    target = encode_utf8_epi16(input, target);
+                }
+                else
+                {
+                    const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(input, _mm_set1_epi16(static_cast<short>(0xF800))), 
+                                                               _mm_set1_epi16(static_cast<short>(0xD800)));
+                    const int mask = _mm_movemask_epi8(surrogates);
+                    if (mask == 0)
+                    {
+                        target = encode_utf8_epi32(_mm_cvtepu16_epi32(input), target);
+                        target = encode_utf8_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(input, 8)), target);
+                    }
+                    else if (mask == 0xFFFF && is_high_surrogate(load_unit(data + pos)))
+                    {
+                        // the input is valid, so the units alternate high, low
+                        const __m128i high = _mm_and_si128(input, _mm_set1_epi32(0x3FF));
+                        const __m128i low = _mm_and_si128(_mm_srli_epi32(input, 16), _mm_set1_epi32(0x3FF));
+                        const __m128i cp = _mm_add_epi32(_mm_or_si128(_mm_slli_epi32(high, 10), low), _mm_set1_epi32(static_cast<int>(half_base)));
+                        target = encode_utf8_supplementary(cp, target);
+                    }
+                    else
+                    {
+                        const uint16_t* p = data + pos;
+                        const uint16_t* block_end = p + 8;
+                        while (p < block_end)
+                        {
+                            encode_valid<uint8_t>(decode_valid(p), target);
+                        }
+                        pos = static_cast<std::size_t>(p - data);
+                        continue;
+                    }
+                }
+                pos += 8;
+            }
+            const uint16_t* p = data + pos;
+            const uint16_t* end = data + length;
+            while (p != end)
+            {
+                encode_valid<uint8_t>(decode_valid(p), target);
+            }
+            return target;
+        }
+    };
+
+    // To UTF-32, blocks without surrogates are widened, and blocks of four 
+    // surrogate pairs are combined in 32-bit lanes. In other blocks each 
+    // code unit is decoded in a 32-bit lane, with a high surrogate combined 
+    // with the code unit that follows it, and the lanes of low surrogates 
+    // are packed out.
+    template <>
+    struct utf16_transcode_kernel<uint32_t>
+    {
+        typedef uint16_t source_type;
+        typedef uint32_t target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const uint16_t* data, std::size_t length) noexcept
+        {
+            return utf16_valid_prefix(data, length);
+        }
+
+        // Decodes 4 code units in 32-bit lanes, given the code units that follow them
+        template <typename T>
+        static T* combine_pairs(__m128i units, __m128i next, T* target) noexcept
+        {
+            const __m128i kind = _mm_and_si128(units, _mm_set1_epi32(0xFC00));
+            const __m128i high = _mm_cmpeq_epi32(kind, _mm_set1_epi32(static_cast<int>(sur_high_start)));
+            const __m128i low = _mm_cmpeq_epi32(kind, _mm_set1_epi32(static_cast<int>(sur_low_start)));
+            // (high - 0xD800) << 10 + (low - 0xDC00) + 0x10000
+            const __m128i pair = _mm_sub_epi32(_mm_add_epi32(_mm_slli_epi32(units, half_shift), next), 
+                                               _mm_set1_epi32(static_cast<int>((sur_high_start << half_shift) + sur_low_start - half_base)));
+            const __m128i cp = _mm_blendv_epi8(units, pair, high);
+            // one bit for each 16-bit lane of the codepoints that are kept
+            const unsigned keep = static_cast<unsigned>(_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi32(low, _mm_setzero_si128()), _mm_setzero_si128())));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target), pack_epi16(cp, keep));
+            return target + _mm_popcnt_u32(keep) / 2;
+        }
+
+        template <typename T>
+        static T* transcode(const uint16_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+            // A block stores 4 codepoints at a time, some of which may be past its output.
+            // 15 more code units give at least 8 more codepoints to overwrite them.
+            while (length - pos >= 24)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(input, _mm_set1_epi16(static_cast<short>(0xF800))), 
+                                                           _mm_set1_epi16(static_cast<short>(0xD800)));
+                if (_mm_testz_si128(surrogates, surrogates))
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_cvtepu16_epi32(input));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 4), _mm_cvtepu16_epi32(_mm_srli_si128(input, 8)));
+                    target += 8;
+                    pos += 8;
+                }
+                else if (_mm_movemask_epi8(surrogates) == 0xFFFF && is_high_surrogate(load_unit(data + pos)))
+                {
+                    // the input is valid, so the units alternate high, low
+                    const __m128i high = _mm_and_si128(input, _mm_set1_epi32(0x3FF));
+                    const __m128i low = _mm_and_si128(_mm_srli_epi32(input, 16), _mm_set1_epi32(0x3FF));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target), 
+                                     _mm_add_epi32(_mm_or_si128(_mm_slli_epi32(high, half_shift), low), _mm_set1_epi32(static_cast<int>(half_base))));
+                    target += 4;
+                    pos += 8;
+                }
+                else
+                {
+                    const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1));
+                    target = combine_pairs(_mm_cvtepu16_epi32(input), _mm_cvtepu16_epi32(next), target);
+                    target = combine_pairs(_mm_cvtepu16_epi32(_mm_srli_si128(input, 8)), _mm_cvtepu16_epi32(_mm_srli_si128(next, 8)), target);
+                    // the last pair may end in the code unit after the block
+                    pos += 8;
+                    if (is_low_surrogate(load_unit(data + pos)))
+                    {
+                        ++pos;
+                    }
+                }
+            }
+            const uint16_t* p = data + pos;
+            const uint16_t* end = data + length;
+            while (p != end)
+            {
+                *target++ = decode_valid(p);
+            }
+            return target;
+        }
+    };
+
+    /*
+     * UTF-32 to UTF-8 or UTF-16 for valid input, 8 codepoints at a time. 
+     * The input has been range checked a block at a time by utf32_valid_prefix.
+     */
+    template <typename CodeUnit>
+    struct utf32_encode_kernel;
+
+    // Blocks of ASCII are narrowed, blocks of 1 and 2 byte sequences and 
+    // blocks of 1 to 3 byte sequences are encoded as for UTF-16, and 
+    // 4 supplementary codepoints are encoded to 16 bytes. Other blocks of
+    // 4 are encoded a codepoint at a time.
+    template <>
+    struct utf32_encode_kernel<uint8_t>
+    {
+        typedef uint32_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 4;
+
+        static std::size_t valid_prefix(const uint32_t* data, std::size_t length) noexcept
+        {
+            return utf32_valid_prefix(data, length);
+        }
+
+        template <typename T>
+        static T* encode_block(const uint32_t* data, __m128i ch, T* target) noexcept
+        {
+            const int supplementary = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(ch, _mm_set1_epi32(0xFFFF))));
+            if (supplementary == 0)
+            {
+                return encode_utf8_epi32(ch, target);
+            }
+            if (supplementary == 0xF)
+            {
+                return encode_utf8_supplementary(ch, target);
+            }
+            for (const uint32_t* p = data; p != data + 4; ++p)
+            {
+                encode_valid<uint8_t>(load_unit(p), target);
+            }
+            return target;
+        }
+
+        template <typename T>
+        static T* transcode(const uint32_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+            // A block stores 8 bytes at a time, some of which may be past its output.
+            // 8 more codepoints give at least 8 more bytes to overwrite them.
+            while (length - pos >= 16)
+            {
+                const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 4));
+                const __m128i both = _mm_or_si128(v0, v1);
+                if (_mm_testz_si128(both, _mm_set1_epi32(~0x7F)))
+                {
+                    const __m128i units = _mm_packus_epi32(v0, v1);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(units, units));
+                    target += 8;
+                }
+                else if (_mm_testz_si128(both, _mm_set1_epi32(~0x7FF)))
+                {
+                    target = encode_utf8_epi16(_mm_packus_epi32(v0, v1), target);
+                }
+                else
+                {
+                    target = encode_block(data + pos, v0, target);
+                    target = encode_block(data + pos + 4, v1, target);
+                }
+                pos += 8;
+            }
+            for (const uint32_t* p = data + pos; p != data + length; ++p)
+            {
+                encode_valid<uint8_t>(load_unit(p), target);
+            }
+            return target;
+        }
+    };
+
+    // Blocks of BMP codepoints are narrowed. In other blocks each codepoint
+    // is encoded in its 32-bit lane as one code unit or a surrogate pair, 
+    // and the unused code units are packed out.
+    template <>
+    struct utf32_encode_kernel<uint16_t>
+    {
+        typedef uint32_t source_type;
+        typedef uint16_t target_type;
+        static constexpr std::size_t max_expansion = 2;
+
+        static std::size_t valid_prefix(const uint32_t* data, std::size_t length) noexcept
+        {
+            return utf32_valid_prefix(data, length);
+        }
+
+        template <typename T>
+        static T* encode_block(__m128i ch, T* target) noexcept
+        {
+            const __m128i supplementary = _mm_cmpgt_epi32(ch, _mm_set1_epi32(0xFFFF));
+            const __m128i cp = _mm_sub_epi32(ch, _mm_set1_epi32(static_cast<int>(half_base)));
+            const __m128i high = _mm_add_epi32(_mm_srli_epi32(cp, half_shift), _mm_set1_epi32(static_cast<int>(sur_high_start)));
+            const __m128i low = _mm_add_epi32(_mm_and_si128(cp, _mm_set1_epi32(static_cast<int>(half_mask))), _mm_set1_epi32(static_cast<int>(sur_low_start)));
+            const __m128i units = _mm_blendv_epi8(ch, _mm_or_si128(high, _mm_slli_epi32(low, 16)), supplementary);
+            // one bit for each 16-bit lane that is kept
+            const unsigned keep = static_cast<unsigned>(_mm_movemask_epi8(_mm_packs_epi16(_mm_or_si128(_mm_set1_epi32(0xFFFF), supplementary), _mm_setzero_si128())));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target), pack_epi16(units, keep));
+            return target + _mm_popcnt_u32(keep);
+        }
+
+        template <typename T>
+        static T* transcode(const uint32_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+            // A block stores 8 code units at a time, some of which may be past its output.
+            // 8 more codepoints give at least 8 more code units to overwrite them.
+            while (length - pos >= 16)
+            {
+                const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 4));
+                if (_mm_testz_si128(_mm_or_si128(v0, v1), _mm_set1_epi32(~0xFFFF)))
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_packus_epi32(v0, v1));
+                    target += 8;
+                }
+                else
+                {
+                    target = encode_block(v0, target);
+                    target = encode_block(v1, target);
+                }
+                pos += 8;
+            }
+            for (const uint32_t* p = data + pos; p != data + length; ++p)
+            {
+                encode_valid<uint16_t>(load_unit(p), target);
+            }
+            return target;
+        }
+    };
+
+#endif
+
+#if !defined(UNICONS_SSE42)
+
+    // Without SIMD, the prefix of ASCII characters of a contiguous range is found 
+    // a word at a time, and widened or narrowed to the target
+    template <typename SourceUnit, typename TargetUnit>
+    struct ascii_transcode_kernel
+    {
+        typedef SourceUnit source_type;
+        typedef TargetUnit target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        // A range shorter than a word is left to the code unit at a time loop
+        static std::size_t valid_prefix(const SourceUnit* data, std::size_t length) noexcept
+        {
+            return length < sizeof(uint64_t) / sizeof(SourceUnit) ? 0 : ascii_prefix(data, length);
+        }
+
+        static std::size_t output_length(const SourceUnit*, std::size_t length) noexcept
+        {
+            return length;
+        }
+
+        template <typename T>
+        static T* transcode(const SourceUnit* data, std::size_t length, T* target) noexcept
+        {
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                target[i] = static_cast<T>(load_unit(data + i));
+            }
+            return target + length;
+        }
+    };
+
+#endif
+
+    // Copies the valid prefix of a contiguous range to a target of the same 
+    // encoding, a chunk at a time. The target may overlap the source only if
+    // it starts at or before the source, as when a range is converted in place.
+    template <typename CodeUnit>
+    struct copy_kernel
+    {
+        typedef CodeUnit source_type;
+        typedef CodeUnit target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const CodeUnit* data, std::size_t length) noexcept
+        {
+            return detail::valid_prefix(data, length);
+        }
+
+        template <typename T>
+        static T* transcode(const CodeUnit* data, std::size_t length, T* target) noexcept
+        {
+            std::memmove(target, data, length*sizeof(CodeUnit));
+            return target + length;
+        }
+    };
+
+    // Transcodes the valid prefix of a contiguous UTF-8 range to UTF-16 or UTF-32
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    InputIt transcode_from_utf8(InputIt first, InputIt last, OutputIt& target)
+    {
+#if defined(UNICONS_SSE42)
+        return transcode_prefix<utf8_decode_kernel<CodeUnit>>(first, last, target);
+#else
+        return transcode_prefix<ascii_transcode_kernel<uint8_t,CodeUnit>>(first, last, target);
+#endif
+    }
+
+    // Transcodes the valid prefix of a contiguous UTF-32 range to UTF-8 or UTF-16
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    InputIt transcode_from_utf32(InputIt first, InputIt last, OutputIt& target)
+    {
+#if defined(UNICONS_SSE42)
+        return transcode_prefix<utf32_encode_kernel<CodeUnit>>(first, last, target);
+#else
+        return transcode_prefix<ascii_transcode_kernel<uint32_t,CodeUnit>>(first, last, target);
+#endif
+    }
+
+    // Transcodes the valid prefix of a contiguous UTF-16 range to UTF-8 or UTF-32
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    InputIt transcode_from_utf16(InputIt first, InputIt last, OutputIt& target)
+    {
+#if defined(UNICONS_SSE42)
+        return transcode_prefix<utf16_transcode_kernel<CodeUnit>>(first, last, target);
+#else
+        return transcode_prefix<ascii_transcode_kernel<uint16_t,CodeUnit>>(first, last, target);
+#endif
+    }
+
+    // Transcodes the valid prefix of a contiguous range with the SIMD kernel 
+    // for its pair of encodings, if there is one
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value && sizeof(CodeUnit) != 1,InputIt>::type
+    transcode_valid_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        return transcode_from_utf8<CodeUnit>(first, last, target);
+    }
+
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value && sizeof(CodeUnit) != 2,InputIt>::type
+    transcode_valid_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        return transcode_from_utf16<CodeUnit>(first, last, target);
+    }
+
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value && sizeof(CodeUnit) != 4,InputIt>::type
+    transcode_valid_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        return transcode_from_utf32<CodeUnit>(first, last, target);
+    }
+
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_same_size<typename std::iterator_traits<InputIt>::value_type,CodeUnit>::value,InputIt>::type
+    transcode_valid_prefix(InputIt first, InputIt last, OutputIt& target)
+    {
+        return transcode_prefix<copy_kernel<CodeUnit>>(first, last, target);
+    }
+
+} // namespace detail
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // convert
+
+    template <typename Iterator>
+    struct convert_result
+    {
+        Iterator it;
+        conv_errc ec;
+    };
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, OutputIt target, conv_flags flags=conv_flags::strict) 
+    {
+        (void)flags;
+
+        conv_errc  result = conv_errc();
+        first = detail::transcode_valid_prefix<uint8_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint8_t>(first, last, target);
+                continue;
+            }
+            std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)] + 1;
+            if (length > (std::size_t)(last - first))
+            {
+                return convert_result<InputIt>{first, conv_errc::source_exhausted};
+            }
+            if ((result=is_legal_utf8(first, length)) != conv_errc())
+            {
+                return convert_result<InputIt>{first,result};
+            }
+
+            switch (length) {
+                case 4: *target++ = (static_cast<uint8_t>(*first++));
+                    UNICONS_FALLTHROUGH;
+                case 3: *target++ = (static_cast<uint8_t>(*first++));
+                    UNICONS_FALLTHROUGH;
+                case 2: *target++ = (static_cast<uint8_t>(*first++));
+                    UNICONS_FALLTHROUGH;
+                case 1: *target++ = (static_cast<uint8_t>(*first++));
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_from_utf8<uint16_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint16_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = 0;
+            unsigned short extra_bytes_to_read = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)];
+            if (extra_bytes_to_read >= last - first) 
+            {
+                result = conv_errc::source_exhausted; 
+                break;
+            }
+            /* Do this check whether lenient or strict */
+            if ((result=detail::decode_utf8(first, extra_bytes_to_read+1, ch)) != conv_errc())
+            {
+                break;
+            }
+            first += (extra_bytes_to_read+1);
+
+            if (ch <= max_bmp) { /* Target is a character <= 0xFFFF */
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_surrogate(ch) ) {
+                    if (flags == conv_flags::strict) {
+                        first -= (extra_bytes_to_read+1); /* return to the illegal value itself */
+                        result = conv_errc::source_illegal;
+                        break;
+                    } else {
+                        *target++ = (replacement_char);
+                    }
+                } else {
+                    *target++ = ((uint16_t)ch); /* normal case */
+                }
+            } else if (ch > max_utf16) {
+                if (flags == conv_flags::strict) {
+                    result = conv_errc::source_illegal;
+                    first -= (extra_bytes_to_read+1); /* return to the start */
+                    break; /* Bail out; shouldn't continue */
+                } else {
+                    *target++ = (replacement_char);
+                }
+            } else {
+                /* target is a character in range 0xFFFF - 0x10FFFF. */
+                ch -= half_base;
+                *target++ = ((uint16_t)((ch >> half_shift) + sur_high_start));
+                *target++ = ((uint16_t)((ch & half_mask) + sur_low_start));
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+                     OutputIt target, 
+                     conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_from_utf8<uint32_t>(first, last, target);
+        while (first < last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint32_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = 0;
+            unsigned short extra_bytes_to_read = trailing_bytes_for_utf8[static_cast<uint8_t>(*first)];
+            if (extra_bytes_to_read >= last - first) 
+            {
+                result = conv_errc::source_exhausted; 
+                break;
+            }
+            /* Do this check whether lenient or strict */
+            if ((result=detail::decode_utf8(first, extra_bytes_to_read+1, ch)) != conv_errc()) {
+                break;
+            }
+            first += (extra_bytes_to_read+1);
+
+            if (ch <= max_legal_utf32) {
+                /*
+                 * UTF-16 surrogate values are illegal in UTF-32, and anything
+                 * over Plane 17 (> 0x10FFFF) is illegal.
+                 */
+                if (is_surrogate(ch) ) {
+                    if (flags == conv_flags::strict) {
+                        first -= (extra_bytes_to_read+1); /* return to the illegal value itself */
+                        result = conv_errc::source_illegal;
+                        break;
+                    } else {
+                        *target++ = (replacement_char);
+                    }
+                } else {
+                    *target++ = (ch);
+                }
+            } else { /* i.e., ch > max_legal_utf32 */
+                result = conv_errc::source_illegal;
+                *target++ = (replacement_char);
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    // utf16
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+                     OutputIt target, 
+                     conv_flags flags = conv_flags::strict) {
+        conv_errc  result = conv_errc();
+        first = detail::transcode_from_utf16<uint8_t>(first, last, target);
+        while (first < last) {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint8_t>(first, last, target);
+                continue;
+            }
+            unsigned short bytes_to_write = 0;
+            const uint32_t byteMask = 0xBF;
+            const uint32_t byteMark = 0x80; 
+            uint32_t ch = *first++;
+            /* If we have a surrogate pair, convert to uint32_t first. */
+            if (is_high_surrogate(ch)) {
+                /* If the 16 bits following the high surrogate are in the first buffer... */
+                if (first < last) {
+                    uint32_t ch2 = *first;
+                    /* If it's a low surrogate, convert to uint32_t. */
+                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
+                        ch = ((ch - sur_high_start) << half_shift)
+                            + (ch2 - sur_low_start) + half_base;
+                        ++first;
+                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
+                        --first; /* return to the illegal value itself */
+                        result = conv_errc::unpaired_high_surrogate;
+                        break;
+                    }
+                } else { /* We don't have the 16 bits following the high surrogate. */
+                    --first; /* return to the high surrogate */
+                    result = conv_errc::source_exhausted;
+                    break;
+                }
+            } else if (flags == conv_flags::strict) {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_low_surrogate(ch)) {
+                    --first; /* return to the illegal value itself */
+                    result = conv_errc::source_illegal;
+                    break;
+                }
+            }
+            /* Figure out how many bytes the result will require */
+            if (ch < (uint32_t)0x80) {      
+                bytes_to_write = 1;
+            } else if (ch < (uint32_t)0x800) {     
+                bytes_to_write = 2;
+            } else if (ch < (uint32_t)0x10000) {   
+                bytes_to_write = 3;
+            } else if (ch < (uint32_t)0x110000) {  
+                bytes_to_write = 4;
+            } else {                            
+                bytes_to_write = 3;
+                ch = replacement_char;
+            }
+            
+            uint8_t byte1 = 0;
+            uint8_t byte2 = 0;
+            uint8_t byte3 = 0;
+            uint8_t byte4 = 0;
+
+            switch (bytes_to_write) { // note: everything falls through
+                case 4: byte4 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
+                case 3: byte3 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
+                case 2: byte2 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;UNICONS_FALLTHROUGH;
+                case 1: byte1 = (uint8_t)(ch | first_byte_mark[bytes_to_write]);break;
+            }
+            switch (bytes_to_write) 
+            {
+            case 4: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                *target++ = (byte3);
+                *target++ = (byte4);
+                break;
+            case 3: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                *target++ = (byte3);
+                break;
+            case 2: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                break;
+            case 1: 
+                *target++ = (byte1);
+                break;
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_valid_prefix<uint16_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint16_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = *first++;
+            /* If we have a surrogate pair, convert to uint32_t first. */
+            if (is_high_surrogate(ch)) 
+            {
+                /* If the 16 bits following the high surrogate are in the first buffer... */
+                if (first < last) {
+                    uint32_t ch2 = *first;
+                    /* If it's a low surrogate, */
+                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
+                        *target++ = ((uint16_t)ch);
+                        *target++ = ((uint16_t)ch2);
+                        ++first;
+                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
+                        --first; /* return to the illegal value itself */
+                        result = conv_errc::unpaired_high_surrogate;
+                        break;
+                    }
+                } else { /* We don't have the 16 bits following the high surrogate. */
+                    --first; /* return to the high surrogate */
+                    result = conv_errc::source_exhausted;
+                    break;
+                }
+            } else if (is_low_surrogate(ch)) 
+            {
+                // illegal leading low surrogate
+                if (flags == conv_flags::strict) {
+                    --first; /* return to the illegal value itself */
+                    result = conv_errc::source_illegal;
+                    break;
+                }
+                else
+                {
+                    *target++ = ((uint16_t)ch);
+                }
+            }
+            else
+            {
+                *target++ = ((uint16_t)ch);
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_from_utf16<uint32_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint32_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = *first++;
+            /* If we have a surrogate pair, convert to UTF32 first. */
+            if (is_high_surrogate(ch)) {
+                /* If the 16 bits following the high surrogate are in the first buffer... */
+                if (first < last) {
+                    uint32_t ch2 = *first;
+                    /* If it's a low surrogate, convert to UTF32. */
+                    if (ch2 >= sur_low_start && ch2 <= sur_low_end ) {
+                        ch = ((ch - sur_high_start) << half_shift)
+                            + (ch2 - sur_low_start) + half_base;
+                        ++first;
+                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
+                        --first; /* return to the illegal value itself */
+                        result = conv_errc::source_illegal;
+                        break;
+                    }
+                } else { /* We don't have the 16 bits following the high surrogate. */
+                    --first; /* return to the high surrogate */
+                    result = conv_errc::source_exhausted;
+                    break;
+                }
+            } else if (flags == conv_flags::strict) {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_low_surrogate(ch) ) {
+                    --first; /* return to the illegal value itself */
+                    result = conv_errc::source_illegal;
+                    break;
+                }
+            }
+            *target++ = (ch);
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    // utf32
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+        first = detail::transcode_from_utf32<uint8_t>(first, last, target);
+        while (first < last) {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint8_t>(first, last, target);
+                continue;
+            }
+            unsigned short bytes_to_write = 0;
+            const uint32_t byteMask = 0xBF;
+            const uint32_t byteMark = 0x80; 
+            uint32_t ch = *first++;
+            if (flags == conv_flags::strict ) {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_surrogate(ch)) {
+                    --first; /* return to the illegal value itself */
+                    result = conv_errc::illegal_surrogate_value;
+                    break;
+                }
+            }
+            /*
+             * Figure out how many bytes the result will require. Turn any
+             * illegally large UTF32 things (> Plane 17) into replacement chars.
+             */
+            if (ch < (uint32_t)0x80) {      bytes_to_write = 1;
+            } else if (ch < (uint32_t)0x800) {     bytes_to_write = 2;
+            } else if (ch < (uint32_t)0x10000) {   bytes_to_write = 3;
+            } else if (ch <= max_legal_utf32) {  bytes_to_write = 4;
+            } else {                            
+                bytes_to_write = 3;
+                ch = replacement_char;
+                result = conv_errc::source_illegal;
+            }
+
+            uint8_t byte1 = 0;
+            uint8_t byte2 = 0;
+            uint8_t byte3 = 0;
+            uint8_t byte4 = 0;
+
+            switch (bytes_to_write) {
+            case 4:
+                byte4 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
+                UNICONS_FALLTHROUGH;
+            case 3:
+                byte3 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
+                UNICONS_FALLTHROUGH;
+            case 2:
+                byte2 = (uint8_t)((ch | byteMark) & byteMask); ch >>= 6;
+                UNICONS_FALLTHROUGH;
+            case 1:
+                byte1 = (uint8_t) (ch | first_byte_mark[bytes_to_write]);
+            }
+
+            switch (bytes_to_write) 
+            {
+            case 4: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                *target++ = (byte3);
+                *target++ = (byte4);
+                break;
+            case 3: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                *target++ = (byte3);
+                break;
+            case 2: 
+                *target++ = (byte1);
+                *target++ = (byte2);
+                break;
+            case 1: 
+                *target++ = (byte1);
+                break;
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_from_utf32<uint16_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint16_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = *first++;
+            if (ch <= max_bmp) { /* Target is a character <= 0xFFFF */
+                /* UTF-16 surrogate values are illegal in UTF-32; 0xffff or 0xfffe are both reserved values */
+                if (is_surrogate(ch) ) {
+                    if (flags == conv_flags::strict) {
+                        --first; /* return to the illegal value itself */
+                        result = conv_errc::source_illegal;
+                        break;
+                    } else {
+                        *target++ = (replacement_char);
+                    }
+                } else {
+                    *target++ = ((uint16_t)ch); /* normal case */
+                }
+            } else if (ch > max_legal_utf32) {
+                if (flags == conv_flags::strict) {
+                    result = conv_errc::source_illegal;
+                } else {
+                    *target++ = (replacement_char);
+                }
+            } else {
+                /* target is a character in range 0xFFFF - 0x10FFFF. */
+                ch -= half_base;
+                *target++ = ((uint16_t)((ch >> half_shift) + sur_high_start));
+                *target++ = ((uint16_t)((ch & half_mask) + sur_low_start));
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    template <typename InputIt,class OutputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
+                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt target, 
+            conv_flags flags = conv_flags::strict) 
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::transcode_valid_prefix<uint32_t>(first, last, target);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<uint32_t>(first, last, target);
+                continue;
+            }
+            uint32_t ch = *first++;
+            if (flags == conv_flags::strict ) {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_surrogate(ch)) {
+                    --first; /* return to the illegal value itself */
+                    result = conv_errc::illegal_surrogate_value;
+                    break;
+                }
+            }
+            if (ch <= max_legal_utf32)
+            {
+                *target++ = (ch);
+            }
+            else
+            {
+                *target++ = (replacement_char);
+                result = conv_errc::source_illegal;
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    // A std::ostreambuf_iterator target is written a block at a time
+
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value,convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, std::ostreambuf_iterator<CharT,Traits> target, conv_flags flags=conv_flags::strict) 
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(first, last, detail::ostreambuf_inserter<CharT,Traits>(block), flags);
+        block.flush();
+        return result;
+    }
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // convert to a bounded range
+
+    template <typename InputIt,typename OutputIt>
+    struct bounded_convert_result
+    {
+        InputIt it;
+        OutputIt out;
+        conv_errc ec;
+    };
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+    // The code unit type with the size of CharT
+    template <typename CharT>
+    struct code_unit_type
+    {
+        typedef typename std::conditional<sizeof(CharT) == 1,uint8_t,
+                typename std::conditional<sizeof(CharT) == 2,uint16_t,uint32_t>::type>::type type;
+    };
+
+    // The code unit type that an output iterator accepts, following the 
+    // specializations of is_compatible_output_iterator
+
+    template <typename OutputIt, typename Enable=void>
+    struct output_code_unit
+    {
+    };
+
+    template <typename OutputIt>
+    struct output_code_unit<OutputIt,
+        typename std::enable_if<is_character<typename std::iterator_traits<OutputIt>::value_type>::value>::type>
+    {
+        typedef typename code_unit_type<typename std::iterator_traits<OutputIt>::value_type>::type type;
+    };
+
+    template <typename OutputIt>
+    struct output_code_unit<OutputIt,
+        typename std::enable_if<std::is_void<typename std::iterator_traits<OutputIt>::value_type>::value
+                                && is_character<typename OutputIt::container_type::value_type>::value>::type>
+    {
+        typedef typename code_unit_type<typename OutputIt::container_type::value_type>::type type;
+    };
+
+    template <typename OutputIt>
+    struct output_code_unit<OutputIt,
+        typename std::enable_if<std::is_void<typename std::iterator_traits<OutputIt>::value_type>::value
+                                && is_character<typename OutputIt::char_type>::value>::type>
+    {
+        typedef typename code_unit_type<typename OutputIt::char_type>::type type;
+    };
+
+    // An output iterator that writes through, and advances, an iterator 
+    // owned by the caller
+    template <typename OutputIt>
+    class tracking_output_iterator
+    {
+        OutputIt* it_;
+    public:
+        typedef std::output_iterator_tag iterator_category;
+        typedef typename output_code_unit<OutputIt>::type value_type;
+        typedef void difference_type;
+        typedef void pointer;
+        typedef void reference;
+
+        explicit tracking_output_iterator(OutputIt& it)
+            : it_(std::addressof(it))
+        {
+        }
+
+        template <typename T>
+        tracking_output_iterator& operator=(T value)
+        {
+            **it_ = static_cast<value_type>(value);
+            ++*it_;
+            return *this;
+        }
+
+        tracking_output_iterator& operator*()
+        {
+            return *this;
+        }
+
+        tracking_output_iterator& operator++()
+        {
+            return *this;
+        }
+
+        tracking_output_iterator& operator++(int)
+        {
+            return *this;
+        }
+    };
+
+    template <typename OutputIt, typename Enable=void>
+    struct is_bounded_output_iterator : std::false_type {};
+
+    template <typename OutputIt>
+    struct is_bounded_output_iterator<OutputIt,
+        typename std::enable_if<std::is_base_of<std::random_access_iterator_tag,typename std::iterator_traits<OutputIt>::iterator_category>::value
+                                && is_character<typename std::iterator_traits<OutputIt>::value_type>::value
+                                && is_output_iterator<OutputIt,typename std::iterator_traits<OutputIt>::value_type>::value>::type
+    > : std::true_type {};
+
+    // The most target code units that one source code unit converts to, 
+    // including replacement characters
+    template <typename SourceT, typename TargetT>
+    constexpr std::size_t max_expansion() noexcept
+    {
+        return sizeof(TargetT) == 1 ? (sizeof(SourceT) == 1 ? 1 : sizeof(SourceT) == 2 ? 3 : 4)
+                                    : (sizeof(TargetT) == 2 && sizeof(SourceT) == 4 ? 2 : 1);
+    }
+
+    // Windows shorter than this are converted a sequence at a time, a 
+    // window this long holds any sequence that may be cut off at its end
+    constexpr std::size_t min_bounded_window = 8;
+
+    // The number of code units in the sequence that starts with ch
+
+    template <typename CharT>
+    typename std::enable_if<is_char8<CharT>::value,std::size_t>::type
+    sequence_length(CharT ch) noexcept
+    {
+        return static_cast<std::size_t>(trailing_bytes_for_utf8[static_cast<uint8_t>(ch)]) + 1;
+    }
+
+    template <typename CharT>
+    typename std::enable_if<is_char16<CharT>::value,std::size_t>::type
+    sequence_length(CharT ch) noexcept
+    {
+        return is_high_surrogate(static_cast<uint16_t>(ch)) ? 2 : 1;
+    }
+
+    template <typename CharT>
+    typename std::enable_if<is_char32<CharT>::value,std::size_t>::type
+    sequence_length(CharT) noexcept
+    {
+        return 1;
+    }
+
+    // The end of the sequence that starts at first, or last if it is cut off
+    template <typename Iterator>
+    Iterator sequence_end(Iterator first, Iterator last) noexcept
+    {
+        std::size_t length = (std::min)(sequence_length(*first), static_cast<std::size_t>(std::distance(first, last)));
+        return std::next(first, length);
+    }
+
+    // True if convert stopped at a sequence that was cut off by the end of a window
+    template <typename Iterator>
+    bool is_cut_off(const convert_result<Iterator>& r, Iterator window_last, Iterator last) noexcept
+    {
+        return r.ec == conv_errc::source_exhausted && window_last != last && 
+               sequence_length(*r.it) > static_cast<std::size_t>(std::distance(r.it, window_last));
+    }
+
+} // namespace detail
+
+    // Converts as many whole sequences as fit in [out_first, out_last). The source 
+    // is converted a window at a time, each short enough that it cannot overflow
+    // the target, then a sequence at a time through a small buffer. 
+
+    template <typename InputIt,typename OutputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && detail::is_bounded_output_iterator<OutputIt>::value,bounded_convert_result<InputIt,OutputIt>>::type 
+    convert(InputIt first, InputIt last, 
+            OutputIt out_first, OutputIt out_last,
+            conv_flags flags = conv_flags::strict) 
+    {
+        typedef typename detail::code_unit_type<typename std::iterator_traits<OutputIt>::value_type>::type code_unit;
+        const std::size_t max_expansion = detail::max_expansion<typename std::iterator_traits<InputIt>::value_type,code_unit>();
+
+        OutputIt out = out_first;
+        while (first != last)
+        {
+            const std::size_t remaining = static_cast<std::size_t>(std::distance(first, last));
+            const std::size_t n = (std::min)(remaining, static_cast<std::size_t>(out_last - out) / max_expansion);
+            if (n < detail::min_bounded_window && n != remaining)
+            {
+                break;
+            }
+            InputIt window_last = std::next(first, n);
+            first = detail::transcode_valid_prefix<code_unit>(first, window_last, out);
+            const InputIt window_first = first;
+            const OutputIt window_out = out;
+            auto r = convert(first, window_last, detail::tracking_output_iterator<OutputIt>(out), flags);
+            first = r.it;
+            if (detail::is_cut_off(r, window_last, last))
+            {
+                continue; // the sequence starts the next window
+            }
+            if (r.ec != conv_errc())
+            {
+                if (r.it != window_last)
+                {
+                    return bounded_convert_result<InputIt,OutputIt>{first,out,r.ec};
+                }
+                // convert went on past an illegal value, which is found a 
+                // sequence at a time
+                first = window_first;
+                out = window_out;
+                break;
+            }
+        }
+        while (first != last)
+        {
+            InputIt sequence_last = detail::sequence_end(first, last);
+            code_unit buffer[8];
+            code_unit* p = buffer;
+            auto r = convert(first, sequence_last, detail::tracking_output_iterator<code_unit*>(p), flags);
+            if (r.ec != conv_errc() && r.it == sequence_last && flags == conv_flags::strict)
+            {
+                return bounded_convert_result<InputIt,OutputIt>{first,out,r.ec};
+            }
+            if (p - buffer > out_last - out)
+            {
+                return bounded_convert_result<InputIt,OutputIt>{first,out,conv_errc::target_exhausted};
+            }
+            out = std::copy(buffer, p, out);
+            first = r.it;
+            if (r.ec != conv_errc() && !detail::is_cut_off(r, sequence_last, last))
+            {
+                // in lenient mode, stops just past the replaced value
+                return bounded_convert_result<InputIt,OutputIt>{first,out,r.ec};
+            }
+        }
+        return bounded_convert_result<InputIt,OutputIt>{first,out,conv_errc()};
+    }
+
+    // convert_to
+
+namespace detail {
+
+    // An output iterator that counts the code units written to it
+    template <typename CharT>
+    class counting_output_iterator
+    {
+        std::size_t* count_;
+    public:
+        typedef std::output_iterator_tag iterator_category;
+        typedef CharT value_type;
+        typedef void difference_type;
+        typedef void pointer;
+        typedef void reference;
+
+        explicit counting_output_iterator(std::size_t& count)
+            : count_(std::addressof(count))
+        {
+        }
+
+        template <typename T>
+        counting_output_iterator& operator=(T)
+        {
+            ++*count_;
+            return *this;
+        }
+
+        counting_output_iterator& operator*()
+        {
+            return *this;
+        }
+
+        counting_output_iterator& operator++()
+        {
+            return *this;
+        }
+
+        counting_output_iterator& operator++(int)
+        {
+            return *this;
+        }
+    };
+
+    // Counts the output of the valid prefix of a contiguous range, a chunk at
+    // a time, like transcode_prefix
+    template <typename CharT, typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value,InputIt>::type
+    count_valid_prefix(InputIt first, InputIt last, std::size_t& count) noexcept
+    {
+        typedef typename code_unit_type<typename std::iterator_traits<InputIt>::value_type>::type source_type;
+        if (first == last)
+        {
+            return first;
+        }
+        const source_type* data = code_units<source_type>(first);
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        std::size_t pos = 0;
+        for (;;)
+        {
+            std::size_t n = valid_prefix(data + pos, (std::min)(length - pos, transcode_chunk_size));
+            if (n == 0)
+            {
+                break;
+            }
+            count += valid_length<CharT>(data + pos, n);
+            pos += n;
+        }
+        return advance_by(first, pos);
+    }
+
+    template <typename CharT, typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value,InputIt>::type
+    count_valid_prefix(InputIt first, InputIt, std::size_t&) noexcept
+    {
+        return first;
+    }
+
+    // The number of code units that convert writes for the range
+    template <typename CharT, typename InputIt>
+    std::size_t output_length(InputIt first, InputIt last, conv_flags flags)
+    {
+        std::size_t count = 0;
+        first = count_valid_prefix<CharT>(first, last, count);
+        convert(first, last, counting_output_iterator<CharT>(count), flags);
+        return count;
+    }
+
+    // Sizes the string to length and converts into it, without filling it first 
+    // where the standard library allows
+    template <typename String, typename InputIt>
+    typename std::enable_if<has_resize_and_overwrite<String>::value,convert_result<InputIt>>::type
+    convert_into(String& s, std::size_t length, InputIt first, InputIt last, conv_flags flags)
+    {
+        convert_result<InputIt> result{first, conv_errc()};
+        s.resize_and_overwrite(length, [&](typename String::value_type* p, std::size_t)
+        {
+            result = convert(first, last, p, flags);
+            return length;
+        });
+        return result;
+    }
+
+    template <typename String, typename InputIt>
+    typename std::enable_if<!has_resize_and_overwrite<String>::value,convert_result<InputIt>>::type
+    convert_into(String& s, std::size_t length, InputIt first, InputIt last, conv_flags flags)
+    {
+        if (length == 0)
+        {
+            std::size_t count = 0;
+            return convert(first, last, counting_output_iterator<typename String::value_type>(count), flags);
+        }
+        s.resize(length);
+        return convert(first, last, std::addressof(s[0]), flags);
+    }
+
+} // namespace detail
+
+    template <typename String,typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(InputIt first, InputIt last, conv_flags flags, std::error_code& ec)
+    {
+        String s;
+        std::size_t length = detail::output_length<typename String::value_type>(first, last, flags);
+        convert_result<InputIt> result = detail::convert_into(s, length, first, last, flags);
+        ec = result.ec;
+        return s;
+    }
+
+    template <typename String,typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(InputIt first, InputIt last, std::error_code& ec)
+    {
+        return convert_to<String>(first, last, conv_flags::strict, ec);
+    }
+
+    template <typename String,typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(InputIt first, InputIt last, conv_flags flags = conv_flags::strict)
+    {
+        std::error_code ec;
+        String s = convert_to<String>(first, last, flags, ec);
+        if (ec)
+        {
+            UNICONS_THROW(unicode_error(ec));
+        }
+        return s;
+    }
+
+    template <typename String,typename Source>
+    typename std::enable_if<is_character<typename Source::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(const Source& source, conv_flags flags, std::error_code& ec)
+    {
+        return convert_to<String>(source.begin(), source.end(), flags, ec);
+    }
+
+    template <typename String,typename Source>
+    typename std::enable_if<is_character<typename Source::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(const Source& source, std::error_code& ec)
+    {
+        return convert_to<String>(source.begin(), source.end(), conv_flags::strict, ec);
+    }
+
+    template <typename String,typename Source>
+    typename std::enable_if<is_character<typename Source::value_type>::value
+                            && is_character<typename String::value_type>::value,String>::type
+    convert_to(const Source& source, conv_flags flags = conv_flags::strict)
+    {
+        return convert_to<String>(source.begin(), source.end(), flags);
+    }
+
+    // validate
+
+    template <typename InputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                                   ,convert_result<InputIt>>::type 
+    validate(InputIt first, InputIt last) noexcept
+    {
+        conv_errc  result = conv_errc();
+        first = detail::skip_valid_utf8(first, last);
+        while (first != last)
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::skip_ascii(first, last);
+                continue;
+            }
+            std::size_t length = static_cast<std::size_t>(trailing_bytes_for_utf8[static_cast<uint8_t>(*first)]) + 1;
+            if (length > (std::size_t)(last - first))
+            {
+                return convert_result<InputIt>{first, conv_errc::source_exhausted};
+            }
+            if ((result=is_legal_utf8(first, length)) != conv_errc())
+            {
+                return convert_result<InputIt>{first,result} ;
+            }
+            first += length;
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    // utf16
+
+    template <typename InputIt>
+    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
+                                   ,convert_result<InputIt>>::type 
+    validate(InputIt first, InputIt last)  noexcept
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::skip_valid_utf16(first, last);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::skip_ascii(first, last);
+                continue;
+            }
+            uint32_t ch = *first++;
+            /* If we have a surrogate pair, validate to uint32_t first. */
+            if (is_high_surrogate(ch)) 
+            {
+                /* If the 16 bits following the high surrogate are in the first buffer... */
+                if (first < last) {
+                    uint32_t ch2 = *first;
+                    /* If it's a low surrogate, */
+                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
+                        ++first;
+                    } else {
+                        --first; /* return to the illegal value itself */
+                        result = conv_errc::unpaired_high_surrogate;
+                        break;
+                    }
+                } else { /* We don't have the 16 bits following the high surrogate. */
+                    --first; /* return to the high surrogate */
+                    result = conv_errc::source_exhausted;
+                    break;
+                }
+            } else if (is_low_surrogate(ch)) 
+            {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                --first; /* return to the illegal value itself */
+                result = conv_errc::source_illegal;
+                break;
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+
+    // utf32
+
+
+    template <typename InputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
+                                   ,convert_result<InputIt>>::type 
+    validate(InputIt first, InputIt last) noexcept
+    {
+        conv_errc  result = conv_errc();
+
+        first = detail::skip_valid_utf32(first, last);
+        while (first != last) 
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::skip_ascii(first, last);
+                continue;
+            }
+            uint32_t ch = *first++;
+            /* UTF-16 surrogate values are illegal in UTF-32 */
+            if (is_surrogate(ch)) {
+                --first; /* return to the illegal value itself */
+                result = conv_errc::illegal_surrogate_value;
+                break;
+            }
+            if (!(ch <= max_legal_utf32))
+            {
+                --first; /* return to the illegal value itself */
+                result = conv_errc::source_illegal;
+                break;
+            }
+        }
+        return convert_result<InputIt>{first,result} ;
+    }
+
+    // parallel validate and revalidate
+
+namespace detail {
+
+    // Moves a chunk start forward to the start of a sequence. The chunk
+    // before it is validated past the start by chunk_overlap code units,
+    // enough to see the whole of any sequence that begins before it.
+
+    template <typename Iterator>
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    chunk_start(Iterator it, Iterator last) noexcept
+    {
+        for (int i = 0; i < 3 && it != last && (static_cast<uint8_t>(*it) & 0xC0) == 0x80; ++i)
+        {
+            ++it;
+        }
+        return it;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char16<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    chunk_start(Iterator it, Iterator last) noexcept
+    {
+        if (it != last && is_low_surrogate(static_cast<uint16_t>(*it)) && is_high_surrogate(static_cast<uint16_t>(*(it-1))))
+        {
+            ++it;
+        }
+        return it;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char32<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    chunk_start(Iterator it, Iterator) noexcept
+    {
+        return it;
+    }
+
+    template <typename CharT>
+    constexpr std::size_t chunk_overlap() noexcept
+    {
+        // trailing_bytes_for_utf8 allows up to 5 trailing bytes
+        return is_char8<CharT>::value ? 5 : (is_char16<CharT>::value ? 1 : 0);
+    }
+
+    // Moves back from an edit to the start of the sequence that contains the code unit before it
+
+    template <typename Iterator>
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    edit_start(Iterator first, Iterator it) noexcept
+    {
+        if (it == first)
+        {
+            return it;
+        }
+        --it;
+        for (int i = 0; i < 3 && it != first && (static_cast<uint8_t>(*it) & 0xC0) == 0x80; ++i)
+        {
+            --it;
+        }
+        return it;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char16<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    edit_start(Iterator first, Iterator it) noexcept
+    {
+        if (it != first && is_high_surrogate(static_cast<uint16_t>(*(it-1))))
+        {
+            --it;
+        }
+        return it;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_char32<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    edit_start(Iterator, Iterator it) noexcept
+    {
+        return it;
+    }
+
+    // True if a sequence cannot start with ch
+
+    template <typename CharT>
+    typename std::enable_if<is_char8<CharT>::value,bool>::type
+    is_trailing_unit(CharT ch) noexcept
+    {
+        return (static_cast<uint8_t>(ch) & 0xC0) == 0x80;
+    }
+
+    template <typename CharT>
+    typename std::enable_if<is_char16<CharT>::value,bool>::type
+    is_trailing_unit(CharT ch) noexcept
+    {
+        return is_low_surrogate(static_cast<uint16_t>(ch));
+    }
+
+    template <typename CharT>
+    typename std::enable_if<is_char32<CharT>::value,bool>::type
+    is_trailing_unit(CharT) noexcept
+    {
+        return false;
+    }
+
+} // namespace detail
+
+    // Validates a range that was valid before [edit_first,edit_last) was
+    // replaced, looking only at the edit and the sequences around it
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value &&
+                            std::is_base_of<std::random_access_iterator_tag,typename std::iterator_traits<InputIt>::iterator_category>::value
+                                   ,convert_result<InputIt>>::type 
+    revalidate(InputIt first, InputIt last, InputIt edit_first, InputIt edit_last) noexcept
+    {
+        typedef typename std::iterator_traits<InputIt>::value_type char_type;
+
+        InputIt window_first = detail::edit_start(first, edit_first);
+        InputIt window_last = edit_last == first ? edit_last : detail::chunk_start(edit_last, last);
+
+        // Errors from window_last on are in the unedited text
+        std::size_t overlap = (std::min)(detail::chunk_overlap<char_type>(), static_cast<std::size_t>(last - window_last));
+        auto result = validate(window_first, window_last + static_cast<std::ptrdiff_t>(overlap));
+        if (result.ec != conv_errc() && result.it < window_last)
+        {
+            return result;
+        }
+        if (window_last != last && detail::is_trailing_unit(*window_last))
+        {
+            return convert_result<InputIt>{window_last,conv_errc::source_illegal};
+        }
+        return convert_result<InputIt>{last,conv_errc()};
+    }
+
+#if !defined(UNICONS_NO_THREADS)
+
+namespace detail {
+
+    // Smallest chunk worth handing to a thread
+    constexpr std::size_t min_parallel_chunk = 1 << 16;
+
+} // namespace detail
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value &&
+                            std::is_base_of<std::random_access_iterator_tag,typename std::iterator_traits<InputIt>::iterator_category>::value
+                                   ,convert_result<InputIt>>::type 
+    validate(InputIt first, InputIt last, std::size_t num_threads)
+    {
+        typedef typename std::iterator_traits<InputIt>::value_type char_type;
+
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        num_threads = (std::min)(num_threads, length / detail::min_parallel_chunk);
+        if (num_threads <= 1)
+        {
+            return validate(first, last);
+        }
+
+        std::vector<InputIt> starts;
+        starts.reserve(num_threads + 1);
+        starts.push_back(first);
+        for (std::size_t i = 1; i < num_threads; ++i)
+        {
+            starts.push_back(detail::chunk_start(first + static_cast<std::ptrdiff_t>(length / num_threads * i), last));
+        }
+        starts.push_back(last);
+
+        // Each chunk only reports errors that begin before the next chunk,
+        // anything later is left to the chunk that owns it
+        std::vector<convert_result<InputIt>> results(num_threads, convert_result<InputIt>{last,conv_errc()});
+        auto validate_chunk = [&](std::size_t i)
+        {
+            std::size_t overlap = (std::min)(detail::chunk_overlap<char_type>(), static_cast<std::size_t>(last - starts[i+1]));
+            results[i] = validate(starts[i], starts[i+1] + static_cast<std::ptrdiff_t>(overlap));
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (std::size_t i = 1; i < num_threads; ++i)
+        {
+#if !defined(UNICONS_NO_EXCEPTIONS)
+            try
+            {
+                threads.emplace_back(validate_chunk, i);
+            }
+            catch (const std::system_error&)
+            {
+                validate_chunk(i);
+            }
+#else
+            threads.emplace_back(validate_chunk, i);
+#endif
+        }
+        validate_chunk(0);
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            if (results[i].ec != conv_errc() && results[i].it < starts[i+1])
+            {
+                return results[i];
+            }
+        }
+        return convert_result<InputIt>{last,conv_errc()};
+    }
+
+#endif
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // validate_all
+
+    struct validation_error
+    {
+        std::size_t offset;
+        std::size_t length;
+        conv_errc ec;
+    };
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+    // Moves past an illegal sequence to the next character that may start a sequence
+
+    template <typename Iterator>
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    resync(Iterator first, Iterator last) noexcept
+    {
+        ++first;
+        while (first != last && (static_cast<uint8_t>(*first) & 0xC0) == 0x80)
+        {
+            ++first;
+        }
+        return first;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<!is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    resync(Iterator first, Iterator) noexcept
+    {
+        return ++first;
+    }
+
+    template <typename F, typename Enable=void>
+    struct is_error_handler : std::false_type {};
+
+    template <typename F>
+    struct is_error_handler<F, decltype(std::declval<F&>()(std::declval<const validation_error&>()), void())> : std::true_type {};
+
+    template <typename F>
+    void report_error(F& handler, const validation_error& err, std::true_type)
+    {
+        handler(err);
+    }
+
+    template <typename OutputIt>
+    void report_error(OutputIt& out, const validation_error& err, std::false_type)
+    {
+        *out++ = err;
+    }
+
+} // namespace detail
+
+    // Validates the whole range, reporting each illegal sequence to sink,
+    // either a callable taking a validation_error or an output iterator.
+    // Returns the number of errors reported.
+    template <typename InputIt, typename Sink>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value,std::size_t>::type
+    validate_all(InputIt first, InputIt last, Sink sink, 
+                 std::size_t max_errors = (std::numeric_limits<std::size_t>::max)())
+    {
+        std::size_t count = 0;
+        std::size_t offset = 0;
+        while (first != last && count < max_errors)
+        {
+            auto result = validate(first, last);
+            if (result.ec == conv_errc())
+            {
+                break;
+            }
+            offset += static_cast<std::size_t>(std::distance(first, result.it));
+            InputIt next = detail::resync(result.it, last);
+            std::size_t length = static_cast<std::size_t>(std::distance(result.it, next));
+            detail::report_error(sink, validation_error{offset, length, result.ec}, detail::is_error_handler<Sink>());
+            ++count;
+            offset += length;
+            first = next;
+        }
+        return count;
+    }
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // convert_all
+
+    template <typename OutputIt>
+    struct convert_all_result
+    {
+        OutputIt out;
+        std::size_t replacements;
+    };
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+    // Converts a range, advancing target
+    template <typename InputIt, typename OutputIt>
+    convert_result<InputIt> convert_advance(InputIt first, InputIt last, OutputIt& target, conv_flags flags)
+    {
+        first = transcode_valid_prefix<typename output_code_unit<OutputIt>::type>(first, last, target);
+        return convert(first, last, tracking_output_iterator<OutputIt>(target), flags);
+    }
+
+    // Converts up to the first illegal sequence, advancing target. Strict 
+    // conversion from UTF-8 and UTF-16 stops there, from UTF-32 it replaces 
+    // values above U+10FFFF and goes on, so UTF-32 is validated first.
+
+    template <typename InputIt, typename OutputIt>
+    typename std::enable_if<!is_char32<typename std::iterator_traits<InputIt>::value_type>::value,convert_result<InputIt>>::type
+    convert_to_error(InputIt first, InputIt last, OutputIt& target)
+    {
+        return convert_advance(first, last, target, conv_flags::strict);
+    }
+
+    template <typename InputIt, typename OutputIt>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value,convert_result<InputIt>>::type
+    convert_to_error(InputIt first, InputIt last, OutputIt& target)
+    {
+        convert_result<InputIt> result = validate(first, last);
+        convert_advance(first, result.it, target, conv_flags::strict);
+        return result;
+    }
+
+    // Moves past the maximal subpart of an ill-formed sequence, the longest 
+    // prefix of a well-formed sequence, or a single code unit (Unicode 
+    // Table 3-7, and the WHATWG Encoding Standard UTF-8 decoder)
+
+    template <typename Iterator>
+    typename std::enable_if<is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    skip_maximal_subpart(Iterator first, Iterator last) noexcept
+    {
+        const uint8_t lead = static_cast<uint8_t>(*first++);
+        std::size_t trailing = lead >= 0xC2 && lead <= 0xDF ? 1 : lead >= 0xE0 && lead <= 0xEF ? 2 : lead >= 0xF0 && lead <= 0xF4 ? 3 : 0;
+        uint8_t low = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+        uint8_t high = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+        for (; trailing > 0 && first != last; --trailing)
+        {
+            const uint8_t ch = static_cast<uint8_t>(*first);
+            if (ch < low || ch > high)
+            {
+                break;
+            }
+            ++first;
+            low = 0x80;
+            high = 0xBF;
+        }
+        return first;
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<!is_char8<typename std::iterator_traits<Iterator>::value_type>::value,Iterator>::type
+    skip_maximal_subpart(Iterator first, Iterator) noexcept
+    {
+        return ++first;
+    }
+
+} // namespace detail
+
+    // Converts the whole range, replacing each maximal subpart of an illegal
+    // sequence with U+FFFD. Returns the end of the output and the number of
+    // replacements.
+    template <typename InputIt, typename OutputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,typename detail::output_code_unit<OutputIt>::type>::value,
+                            convert_all_result<OutputIt>>::type
+    convert_all(InputIt first, InputIt last, OutputIt target)
+    {
+        std::size_t count = 0;
+        while (first != last)
+        {
+            auto result = detail::convert_to_error(first, last, target);
+            if (result.ec == conv_errc())
+            {
+                break;
+            }
+            detail::encode_valid<typename detail::output_code_unit<OutputIt>::type>(replacement_char, target);
+            ++count;
+            first = detail::skip_maximal_subpart(result.it, last);
+        }
+        return convert_all_result<OutputIt>{target,count};
+    }
+
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value,
+                            convert_all_result<std::ostreambuf_iterator<CharT,Traits>>>::type
+    convert_all(InputIt first, InputIt last, std::ostreambuf_iterator<CharT,Traits> target)
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        std::size_t count = convert_all(first, last, detail::ostreambuf_inserter<CharT,Traits>(block)).replacements;
+        return convert_all_result<std::ostreambuf_iterator<CharT,Traits>>{block.flush(),count};
+    }
+
+    // validator
+
+    template <typename CharT>
+    class validator
+    {
+        static_assert(is_character<CharT>::value, "CharT must be an integral type with size in bits of 8, 16 or 32");
+
+        // A sequence cut off at the end of a chunk. trailing_bytes_for_utf8 
+        // allows up to 5 trailing bytes, so that such leads are reported 
+        // exactly as validate reports them.
+        static constexpr std::size_t max_pending = 6;
+        CharT pending_[max_pending];
+        std::size_t pending_length_;
+        std::size_t pending_offset_;
+        std::size_t offset_;
+        std::size_t error_offset_;
+        conv_errc err_cd_;
+    public:
+        validator() noexcept
+            : pending_length_(0), pending_offset_(0), offset_(0), error_offset_(0), err_cd_(conv_errc())
+        {
+        }
+
+        // Validates the next chunk of the stream. A sequence that is cut off
+        // at the end of the chunk is carried over to the next call.
+        template <typename InputIt>
+        conv_errc feed(InputIt first, InputIt last) noexcept
+        {
+            if (err_cd_ != conv_errc())
+            {
+                return err_cd_;
+            }
+            if (pending_length_ > 0)
+            {
+                std::size_t length = detail::sequence_length(pending_[0]);
+                while (pending_length_ < length && pending_length_ < max_pending && first != last)
+                {
+                    pending_[pending_length_++] = static_cast<CharT>(*first);
+                    ++first;
+                    ++offset_;
+                }
+                if (pending_length_ < length)
+                {
+                    return err_cd_;
+                }
+                auto result = validate(pending_, pending_ + pending_length_);
+                if (result.ec != conv_errc())
+                {
+                    return fail(result.ec, pending_offset_);
+                }
+                pending_length_ = 0;
+            }
+            if (first == last)
+            {
+                return err_cd_;
+            }
+
+            auto result = validate(first, last);
+            std::size_t length = static_cast<std::size_t>(last - first);
+            std::size_t pos = static_cast<std::size_t>(result.it - first);
+            if (result.ec == conv_errc::source_exhausted && detail::sequence_length(*result.it) > length - pos)
+            {
+                pending_offset_ = offset_ + pos;
+                for (; result.it != last && pending_length_ < max_pending; ++result.it)
+                {
+                    pending_[pending_length_++] = static_cast<CharT>(*result.it);
+                }
+            }
+            else if (result.ec != conv_errc())
+            {
+                fail(result.ec, offset_ + pos);
+            }
+            offset_ += length;
+            return err_cd_;
+        }
+
+        // Ends the stream. A sequence still pending is reported as source_exhausted.
+        conv_errc finish() noexcept
+        {
+            if (err_cd_ == conv_errc() && pending_length_ > 0)
+            {
+                fail(conv_errc::source_exhausted, pending_offset_);
+            }
+            return err_cd_;
+        }
+
+        conv_errc status() const noexcept
+        {
+            return err_cd_;
+        }
+
+        // The offset in the stream of the first code unit of the illegal sequence
+        std::size_t error_offset() const noexcept
+        {
+            return error_offset_;
+        }
+
+        // The number of code units fed so far
+        std::size_t offset() const noexcept
+        {
+            return offset_;
+        }
+
+        void reset() noexcept
+        {
+            pending_length_ = 0;
+            pending_offset_ = 0;
+            offset_ = 0;
+            error_offset_ = 0;
+            err_cd_ = conv_errc();
+        }
+    private:
+        conv_errc fail(conv_errc ec, std::size_t offset) noexcept
+        {
+            err_cd_ = ec;
+            error_offset_ = offset;
+            return err_cd_;
+        }
+    };
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // valid_view
+
+    struct assume_valid_t {};
+
+    constexpr assume_valid_t assume_valid{};
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+    // A range of characters that is known to be valid. It is obtained from 
+    // validate, or constructed with assume_valid by a caller that vouches 
+    // for the range.
+    template <typename Iterator>
+    class valid_view
+    {
+        Iterator first_;
+        Iterator last_;
+    public:
+        using iterator = Iterator;
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+        valid_view() noexcept
+            : first_(), last_()
+        {
+        }
+
+        valid_view(Iterator first, Iterator last, assume_valid_t) noexcept
+            : first_(first), last_(last)
+        {
+        }
+
+        Iterator begin() const noexcept
+        {
+            return first_;
+        }
+
+        Iterator end() const noexcept
+        {
+            return last_;
+        }
+
+        bool empty() const noexcept
+        {
+            return first_ == last_;
+        }
+    };
+
+    using valid_utf8_view = valid_view<const char*>;
+    using valid_utf16_view = valid_view<const char16_t*>;
+    using valid_utf32_view = valid_view<const char32_t*>;
+
+    template <typename InputIt, typename Iterator>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value &&
+                            std::is_convertible<InputIt,Iterator>::value
+                                   ,convert_result<InputIt>>::type 
+    validate(InputIt first, InputIt last, valid_view<Iterator>& view) noexcept
+    {
+        auto result = validate(first, last);
+        if (result.ec == conv_errc())
+        {
+            view = valid_view<Iterator>(first, last, assume_valid);
+        }
+        return result;
+    }
+
+namespace detail {
+
+    // The length of the whole sequences at the start of a valid range, which 
+    // falls short of the length if the range was cut off inside a sequence
+
+    inline
+    std::size_t whole_sequences(const uint8_t* data, std::size_t length) noexcept
+    {
+        std::size_t pos = length;
+        while (pos > 0 && length - pos < 4 && is_continuation_byte(data[pos-1]))
+        {
+            --pos;
+        }
+        return pos > 0 && pos - 1 + sequence_length(data[pos-1]) > length ? pos - 1 : length;
+    }
+
+    inline
+    std::size_t whole_sequences(const uint16_t* data, std::size_t length) noexcept
+    {
+        return length > 0 && is_high_surrogate(load_unit(data + length - 1)) ? length - 1 : length;
+    }
+
+    inline
+    std::size_t whole_sequences(const uint32_t*, std::size_t length) noexcept
+    {
+        return length;
+    }
+
+    // Without SIMD, a valid range is transcoded a character at a time, 
+    // reading and writing through pointers. A UTF-8 sequence is written 
+    // with one branch on its length.
+    template <typename SourceUnit, typename TargetUnit>
+    struct valid_transcode_kernel
+    {
+        typedef SourceUnit source_type;
+        typedef TargetUnit target_type;
+        static constexpr std::size_t max_expansion = detail::max_expansion<SourceUnit,TargetUnit>();
+
+        template <typename T>
+        static T* transcode(const SourceUnit* data, std::size_t length, T* target) noexcept
+        {
+            const SourceUnit* last = data + length;
+            while (data != last)
+            {
+                target = encode(decode_valid(data), target, std::integral_constant<bool,sizeof(TargetUnit) == 1>());
+            }
+            return target;
+        }
+    private:
+        template <typename T>
+        static T* encode(uint32_t ch, T* target, std::true_type) noexcept
+        {
+            const std::size_t n = ch < 0x80 ? 1 : ch < 0x800 ? 2 : ch < 0x10000 ? 3 : 4;
+            switch (n)
+            {
+                case 4: 
+                    target[3] = static_cast<T>(0x80 | (ch & 0x3F)); ch >>= 6;
+                    UNICONS_FALLTHROUGH;
+                case 3: 
+                    target[2] = static_cast<T>(0x80 | (ch & 0x3F)); ch >>= 6;
+                    UNICONS_FALLTHROUGH;
+                case 2: 
+                    target[1] = static_cast<T>(0x80 | (ch & 0x3F)); ch >>= 6;
+                    UNICONS_FALLTHROUGH;
+                default: 
+                    target[0] = static_cast<T>(ch | first_byte_mark[n]);
+            }
+            return target + n;
+        }
+
+        template <typename T>
+        static T* encode(uint32_t ch, T* target, std::false_type) noexcept
+        {
+            encode_valid<TargetUnit>(ch, target);
+            return target;
+        }
+    };
+
+    // Runs Kernel over a range that is already known to be valid, taking 
+    // each chunk up to its last whole sequence without checking it
+    template <typename Kernel>
+    struct assume_valid_kernel : Kernel
+    {
+        static std::size_t valid_prefix(const typename Kernel::source_type* data, std::size_t length) noexcept
+        {
+            return whole_sequences(data, length);
+        }
+    };
+
+    // The kernel that converts a valid range from SourceUnit to TargetUnit
+    template <typename SourceUnit, typename TargetUnit, typename Enable=void>
+    struct valid_kernel
+    {
+        typedef assume_valid_kernel<valid_transcode_kernel<SourceUnit,TargetUnit>> type;
+    };
+
+    template <typename CodeUnit>
+    struct valid_kernel<CodeUnit,CodeUnit>
+    {
+        typedef assume_valid_kernel<copy_kernel<CodeUnit>> type;
+    };
+
+#if defined(UNICONS_SSE42)
+
+    template <typename TargetUnit>
+    struct valid_kernel<uint8_t,TargetUnit,typename std::enable_if<sizeof(TargetUnit) != 1>::type>
+    {
+        typedef assume_valid_kernel<utf8_decode_kernel<TargetUnit>> type;
+    };
+
+    template <typename TargetUnit>
+    struct valid_kernel<uint16_t,TargetUnit,typename std::enable_if<sizeof(TargetUnit) != 2>::type>
+    {
+        typedef assume_valid_kernel<utf16_transcode_kernel<TargetUnit>> type;
+    };
+
+    template <typename TargetUnit>
+    struct valid_kernel<uint32_t,TargetUnit,typename std::enable_if<sizeof(TargetUnit) != 4>::type>
+    {
+        typedef assume_valid_kernel<utf32_encode_kernel<TargetUnit>> type;
+    };
+
+#endif
+
+    // A contiguous range is converted with its kernel, an iterator range 
+    // a character at a time
+
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<is_same_size<typename std::iterator_traits<InputIt>::value_type,CodeUnit>::value>::type
+    convert_valid(InputIt first, InputIt last, OutputIt& target)
+    {
+        first = transcode_prefix<typename valid_kernel<CodeUnit,CodeUnit>::type>(first, last, target);
+        for (; first != last; ++first)
+        {
+            *target++ = static_cast<CodeUnit>(*first);
+        }
+    }
+
+    template <typename CodeUnit, typename InputIt, typename OutputIt>
+    typename std::enable_if<!is_same_size<typename std::iterator_traits<InputIt>::value_type,CodeUnit>::value>::type
+    convert_valid(InputIt first, InputIt last, OutputIt& target)
+    {
+        typedef typename code_unit_type<typename std::iterator_traits<InputIt>::value_type>::type source_unit;
+
+        first = transcode_prefix<typename valid_kernel<source_unit,CodeUnit>::type>(first, last, target);
+        while (first != last)
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                first = detail::copy_ascii<CodeUnit>(first, last, target);
+                continue;
+            }
+            encode_valid<CodeUnit>(decode_valid(first), target);
+        }
+    }
+
+} // namespace detail
+
+    // Converts a valid range, without checking
+
+    template <typename Iterator,class OutputIt>
+    typename std::enable_if<is_compatible_output_iterator<OutputIt,uint8_t>::value,convert_result<Iterator>>::type 
+    convert(const valid_view<Iterator>& source, OutputIt target) 
+    {
+        detail::convert_valid<uint8_t>(source.begin(), source.end(), target);
+        return convert_result<Iterator>{source.end(),conv_errc()};
+    }
+
+    template <typename Iterator,class OutputIt>
+    typename std::enable_if<is_compatible_output_iterator<OutputIt,uint16_t>::value,convert_result<Iterator>>::type 
+    convert(const valid_view<Iterator>& source, OutputIt target) 
+    {
+        detail::convert_valid<uint16_t>(source.begin(), source.end(), target);
+        return convert_result<Iterator>{source.end(),conv_errc()};
+    }
+
+    template <typename Iterator,class OutputIt>
+    typename std::enable_if<is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<Iterator>>::type 
+    convert(const valid_view<Iterator>& source, OutputIt target) 
+    {
+        detail::convert_valid<uint32_t>(source.begin(), source.end(), target);
+        return convert_result<Iterator>{source.end(),conv_errc()};
+    }
+
+    template <typename Iterator,typename CharT,typename Traits>
+    typename std::enable_if<is_character<CharT>::value,convert_result<Iterator>>::type 
+    convert(const valid_view<Iterator>& source, std::ostreambuf_iterator<CharT,Traits> target) 
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<Iterator> result = convert(source, detail::ostreambuf_inserter<CharT,Traits>(block));
+        block.flush();
+        return result;
+    }
+
+    // sequence 
+
+    template <typename Iterator>
+    class sequence
+    {
+        Iterator first_;
+        std::size_t length_;
+    public:
+        sequence(Iterator first, std::size_t length)
+            : first_(first), length_(length)
+        {
+        }
+
+        Iterator begin() const
+        {
+            return first_;
+        }
+
+        std::size_t length() const
+        {
+            return length_;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char8<CharT>::value,uint32_t>::type 
+        codepoint() const noexcept
+        {
+            uint32_t ch = 0;
+            if (length_ == 0 || length_ > 4 || detail::decode_utf8(first_, length_, ch) != conv_errc())
+            {
+                return replacement_char;
+            }
+            return ch;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char16<CharT>::value,uint32_t>::type 
+        codepoint() const noexcept
+        {
+            if (length_ == 0)
+            {
+                return replacement_char;
+            }
+            if (length_ == 2)
+            {
+                uint32_t ch = *first_;
+                uint32_t ch2 = *(first_+ 1);
+                ch = ((ch - sur_high_start) << half_shift)
+                     + (ch2 - sur_low_start) + half_base;
+                return ch;
+            }
+            else 
+            {
+                return *first_;
+            }
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char32<CharT>::value,uint32_t>::type 
+        codepoint() const noexcept
+        {
+            if (length_ == 0)
+            {
+                return replacement_char;
+            }
+            return *(first_);
+        }
+    };
+
+    // sequence_generator
+
+    template <typename Iterator>
+    class sequence_generator
+    {
+        Iterator begin_;
+        Iterator last_;
+        conv_flags flags_;
+        std::size_t length_;
+        conv_errc err_cd_;
+    public:
+        using sequence_type = sequence<Iterator>;
+
+        sequence_generator(Iterator first, Iterator last, 
+                           conv_flags flags = conv_flags::strict) noexcept
+            : begin_(first), last_(last), flags_(flags), 
+              length_(0), err_cd_(conv_errc())
+        {
+            next();
+        }
+
+        bool done() const noexcept
+        {
+            return err_cd_ != conv_errc() || begin_ == last_;
+        }
+
+        conv_errc status() const noexcept
+        {
+            return err_cd_;
+        }
+
+        sequence_type get() const noexcept
+        {
+            return sequence<Iterator>(begin_,length_);
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char8<CharT>::value>::type 
+        next() noexcept
+        {
+            begin_ += length_;
+            if (begin_ != last_)
+            {
+                std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*begin_)] + 1;
+                if (length > (std::size_t)(last_ - begin_))
+                {
+                    err_cd_ = conv_errc::source_exhausted;
+                }
+                else if ((err_cd_ = is_legal_utf8(begin_, length)) != conv_errc())
+                {
+                }
+                else
+                {
+                    length_ = length;
+                }
+            }
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char16<CharT>::value>::type 
+        next() noexcept
+        {
+            begin_ += length_;
+            if (begin_ != last_)
+            {
+                if (begin_ != last_)
+                {
+
+                    Iterator it = begin_;
+
+                    uint32_t ch = *it++;
+                    /* If we have a surrogate pair, validate to uint32_t it. */
+                    if (is_high_surrogate(ch)) 
+                    {
+                        /* If the 16 bits following the high surrogate are in the it buffer... */
+                        if (it < last_) {
+                            uint32_t ch2 = *it;
+                            /* If it's a low surrogate, */
+                            if (ch2 >= sur_low_start && ch2 <= sur_low_end) 
+                            {
+                                ++it;
+                                length_ = 2;
+                            } 
+                            else 
+                            {
+                                err_cd_ = conv_errc::unpaired_high_surrogate;
+                            }
+                        } 
+                        else 
+                        { 
+                            // We don't have the 16 bits following the high surrogate.
+                            err_cd_ = conv_errc::source_exhausted;
+                        }
+                    } 
+                    else if (is_low_surrogate(ch)) 
+                    {
+                        /* leading low surrogate */
+                        err_cd_ = conv_errc::source_illegal;
+                    }
+                    else
+                    {
+                        length_ = 1;
+                    }
+                }
+            }
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
+        typename std::enable_if<is_char32<CharT>::value>::type 
+        next() noexcept
+        {
+            begin_ += length_;
+            length_ = 1;
+        }
+    };
+
+    template <typename Iterator>
+    sequence_generator<Iterator> make_sequence_generator(Iterator first, Iterator last,
+        conv_flags flags = conv_flags::strict)
+    {
+        return sequence_generator<Iterator>(first, last, flags);
+    }
+
+    template <typename InputIt>
+    typename std::enable_if<(is_char8<typename std::iterator_traits<InputIt>::value_type>::value || is_char16<typename std::iterator_traits<InputIt>::value_type>::value),
+                                   sequence<InputIt>>::type 
+    sequence_at(InputIt first, InputIt last, std::size_t index) 
+    {
+        sequence_generator<InputIt> g(first, last, unicons::conv_flags::strict);
+
+        std::size_t count = 0;
+        while (!g.done() && count < index)
+        {
+            g.next();
+            ++count;
+        }
+        return (!g.done() && count == index) ? g.get() : sequence<InputIt>(last,0);
+    }
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,
+                                   sequence<InputIt>>::type 
+    sequence_at(InputIt first, InputIt last, std::size_t index) 
+    {
+        std::size_t size = std::distance(first,last);
+        return index < size ? sequence<InputIt>(first+index,1) : sequence<InputIt>(last,0);
+    }
+
+    // codepoint_iterator
+
+    template <typename Iter>
+    class codepoint_iterator
+    {
+        Iter it_;
+        Iter last_;
+        conv_flags flags_;
+        std::size_t length_;
+    public:
+        using iterator_type = Iter;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = const value_type&;
+        using iterator_category = std::input_iterator_tag;
+
+        codepoint_iterator() noexcept
+            : length_(0)
+        {
+        }
+
+        codepoint_iterator(Iter first, Iter last, 
+                           conv_flags flags = conv_flags::strict) 
+            : it_(first), last_(last), flags_(flags), length_(0)
+        {
+            operator++();
+        }
+
+        codepoint_iterator(Iter first, Iter last, 
+                           std::error_code& ec) noexcept
+            : codepoint_iterator(first, last, conv_flags::strict, ec)
+        {
+        }
+
+        codepoint_iterator(Iter first, Iter last, 
+                           conv_flags flags, std::error_code& ec) noexcept
+            : it_(first), last_(last), flags_(flags), length_(0)
+        {
+            increment(ec);
+        }
+
+        codepoint_iterator(const codepoint_iterator&) = default;
+
+        codepoint_iterator(codepoint_iterator&&) = default; 
+
+        codepoint_iterator& operator=(const codepoint_iterator&) = default;
+
+        codepoint_iterator& operator=(codepoint_iterator&&) = default;
+
+        constexpr iterator_type base() const noexcept
+        {
+            return it_;
+        }
+
+        uint32_t operator*() const noexcept
+        {
+            return get_codepoint();
+        }
+
+        codepoint_iterator& operator++()
+        {
+            std::error_code ec;
+            increment(ec);
+            if (ec)
+            {
+                UNICONS_THROW(unicode_error(ec));
+            }
+            return *this;
+        }
+
+        codepoint_iterator operator++(int) // postfix increment
+        {
+            codepoint_iterator temp(*this);
+            ++(*this);
+            return temp;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char8<CharT>::value,codepoint_iterator& >::type 
+        increment(std::error_code& ec) noexcept
+        {
+            it_ += length_;
+            if (it_ != last_)
+            {
+                std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*it_)] + 1;
+                if (length > (std::size_t)(last_ - it_))
+                {
+                    ec = conv_errc::source_exhausted;
+                }
+                else
+                {
+                    ec = is_legal_utf8(it_, length);
+                    if (!ec)
+                    {
+                        length_ = length;
+                    }
+                }
+            }
+            return *this;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char16<CharT>::value,codepoint_iterator& >::type 
+        increment(std::error_code& ec) noexcept
+        {
+            it_ += length_;
+            if (it_ != last_)
+            {
+                if (it_ != last_)
+                {
+
+                    Iter it = it_;
+
+                    uint32_t ch = *it++;
+                    /* If we have a surrogate pair, validate to uint32_t it. */
+                    if (is_high_surrogate(ch)) 
+                    {
+                        /* If the 16 bits following the high surrogate are in the it buffer... */
+                        if (it < last_) {
+                            uint32_t ch2 = *it;
+                            /* If it's a low surrogate, */
+                            if (ch2 >= sur_low_start && ch2 <= sur_low_end) 
+                            {
+                                ++it;
+                                length_ = 2;
+                            } 
+                            else 
+                            {
+                                ec = conv_errc::unpaired_high_surrogate;
+                            }
+                        } 
+                        else 
+                        { 
+                            // We don't have the 16 bits following the high surrogate.
+                            ec = conv_errc::source_exhausted;
+                        }
+                    } 
+                    else if (is_low_surrogate(ch)) 
+                    {
+                        /* leading low surrogate */
+                        ec = conv_errc::source_illegal;
+                    }
+                    else
+                    {
+                        length_ = 1;
+                    }
+                }
+            }
+            return *this;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char32<CharT>::value,codepoint_iterator& >::type 
+        increment(std::error_code&) noexcept
+        {
+            it_ += length_;
+            length_ = 1;
+            return *this;
+        }
+
+        friend bool operator==(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+        {
+            if (rhs.is_end())
+            {
+                return lhs.is_end();
+            }
+            else
+            {
+                return lhs.it_ == rhs.it_;
+            }
+        }
+
+        friend bool operator!=(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+        {
+            return !(lhs == rhs);
+        }
+
+        bool is_end() const noexcept
+        {
+            return length_ == 0 || it_ == last_;
+        }
+
+    private:
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char8<CharT>::value,uint32_t>::type 
+        get_codepoint() const noexcept
+        {
+            uint32_t ch = 0;
+            if (length_ == 0 || length_ > 4 || detail::decode_utf8(it_, length_, ch) != conv_errc())
+            {
+                return replacement_char;
+            }
+            return ch;
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char16<CharT>::value,uint32_t>::type 
+        get_codepoint() const noexcept
+        {
+            if (length_ == 0)
+            {
+                return replacement_char;
+            }
+            if (length_ == 2)
+            {
+                uint32_t ch = *it_;
+                uint32_t ch2 = *(it_+ 1);
+                ch = ((ch - sur_high_start) << half_shift)
+                     + (ch2 - sur_low_start) + half_base;
+                return ch;
+            }
+            else 
+            {
+                return *it_;
+            }
+        }
+
+        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
+        typename std::enable_if<is_char32<CharT>::value,uint32_t>::type 
+        get_codepoint() const noexcept
+        {
+            if (length_ == 0)
+            {
+                return replacement_char;
+            }
+            return *(it_);
+        }
+
+    };
+
+    template <typename InputIt>
+    inline const codepoint_iterator<InputIt>& begin(const codepoint_iterator<InputIt>& iter) noexcept { return iter; }
+
+    template <typename InputIt>
+    inline codepoint_iterator<InputIt> end(const codepoint_iterator<InputIt>&) noexcept { return codepoint_iterator<InputIt>(); }
+
+    template <typename Iter, typename... Args>
+    codepoint_iterator<Iter> make_codepoint_iterator(Iter first, Args&& ... args)
+    {
+        return codepoint_iterator<Iter>(first, std::forward<Args>(args)...);
+    }
+
+    template <typename Iter, typename Distance>
+    void advance(codepoint_iterator<Iter>& it, Distance n, std::error_code& ec) noexcept    
+    {
+        for (std::size_t i = 0; !ec && i < n; ++i)
+        {
+            it.increment(ec);
+        }
+    }
+
+    // sequence_generator and codepoint_iterator over a valid range, without checking
+
+    template <typename Iterator>
+    class sequence_generator<valid_view<Iterator>>
+    {
+        Iterator begin_;
+        Iterator last_;
+        std::size_t length_;
+    public:
+        using sequence_type = sequence<Iterator>;
+
+        explicit sequence_generator(const valid_view<Iterator>& view) noexcept
+            : begin_(view.begin()), last_(view.end()), length_(0)
+        {
+            next();
+        }
+
+        bool done() const noexcept
+        {
+            return begin_ == last_;
+        }
+
+        conv_errc status() const noexcept
+        {
+            return conv_errc();
+        }
+
+        sequence_type get() const noexcept
+        {
+            return sequence<Iterator>(begin_,length_);
+        }
+
+        void next() noexcept
+        {
+            begin_ += length_;
+            length_ = begin_ != last_ ? detail::sequence_length(*begin_) : 0;
+        }
+    };
+
+    template <typename Iterator>
+    sequence_generator<valid_view<Iterator>> make_sequence_generator(const valid_view<Iterator>& view) noexcept
+    {
+        return sequence_generator<valid_view<Iterator>>(view);
+    }
+
+    template <typename Iter>
+    class codepoint_iterator<valid_view<Iter>>
+    {
+        Iter it_;
+        Iter last_;
+        std::size_t length_;
+    public:
+        using iterator_type = Iter;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = const value_type&;
+        using iterator_category = std::input_iterator_tag;
+
+        codepoint_iterator() noexcept
+            : length_(0)
+        {
+        }
+
+        explicit codepoint_iterator(const valid_view<Iter>& view) noexcept
+            : it_(view.begin()), last_(view.end()), length_(0)
+        {
+            operator++();
+        }
+
+        codepoint_iterator(const codepoint_iterator&) = default;
+
+        codepoint_iterator(codepoint_iterator&&) = default; 
+
+        codepoint_iterator& operator=(const codepoint_iterator&) = default;
+
+        codepoint_iterator& operator=(codepoint_iterator&&) = default;
+
+        constexpr iterator_type base() const noexcept
+        {
+            return it_;
+        }
+
+        uint32_t operator*() const noexcept
+        {
+            Iter it = it_;
+            return detail::decode_valid(it);
+        }
+
+        codepoint_iterator& operator++() noexcept
+        {
+            it_ += length_;
+            length_ = it_ != last_ ? detail::sequence_length(*it_) : 0;
+            return *this;
+        }
+
+        codepoint_iterator operator++(int) noexcept
+        {
+            codepoint_iterator temp(*this);
+            ++(*this);
+            return temp;
+        }
+
+        codepoint_iterator& increment(std::error_code&) noexcept
+        {
+            return ++(*this);
+        }
+
+        friend bool operator==(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+        {
+            if (rhs.is_end())
+            {
+                return lhs.is_end();
+            }
+            else
+            {
+                return lhs.it_ == rhs.it_;
+            }
+        }
+
+        friend bool operator!=(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+        {
+            return !(lhs == rhs);
+        }
+
+        bool is_end() const noexcept
+        {
+            return length_ == 0 || it_ == last_;
+        }
+    };
+
+    // u8_length
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char8<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
+    u8_length(InputIt first, InputIt last) noexcept
+    {
+        return std::distance(first,last);
+    }
+
+    // utf16
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char16<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
+    u8_length(InputIt first, InputIt last) noexcept
+    {
+        conv_flags flags = conv_flags::strict;
+        std::size_t count = 0;
+        for (InputIt p = first; p != last; ++p)
+        {
+            if (detail::is_ascii_unit(*p))
+            {
+                InputIt run_last = detail::skip_ascii(p, last);
+                count += static_cast<std::size_t>(run_last - p);
+                p = run_last;
+                if (p == last)
+                {
+                    break;
+                }
+            }
+            uint32_t ch = *p;
+            if (is_high_surrogate(ch)) {
+                /* If the 16 bits following the high surrogate are in the p buffer... */
+                if (p + 1 < last) {
+                    uint32_t ch2 = *(++p);
+                    /* If it's a low surrogate, convert to uint32_t. */
+                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
+                        ch = ((ch - sur_high_start) << half_shift)
+                            + (ch2 - sur_low_start) + half_base;
+                   
+                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
+                        break;
+                    }
+                } else { /* We don't have the 16 bits following the high surrogate. */
+                    break;
+                }
+            } else if (flags == conv_flags::strict) {
+                /* UTF-16 surrogate values are illegal in UTF-32 */
+                if (is_low_surrogate(ch)) {
+                    break;
+                }
+            }
+            if (ch < (uint32_t)0x80) {      
+                ++count;
+            } else if (ch < (uint32_t)0x800) {     
+                count += 2;
+            } else if (ch < (uint32_t)0x10000) {   
+                count += 3;
+            } else if (ch < (uint32_t)0x110000) {  
+                count += 4;
+            } else {                            
+                count += 3;
+            }
+        }
+        return count;
+    }
+
+
+    // utf32
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
+    u8_length(InputIt first, InputIt last) noexcept
+    {
+        std::size_t count = 0;
+        for (InputIt p = first; p < last; ++p)
+        {
+            if (detail::is_ascii_unit(*p))
+            {
+                InputIt run_last = detail::skip_ascii(p, last);
+                count += static_cast<std::size_t>(run_last - p);
+                p = run_last;
+                if (p == last)
+                {
+                    break;
+                }
+            }
+            uint32_t ch = *p;
+            if (ch < (uint32_t)0x80) {      
+                ++count;
+            } else if (ch < (uint32_t)0x800) {     
+                count += 2;
+            } else if (ch < (uint32_t)0x10000) {   
+                count += 3;
+            } else if (ch <= max_legal_utf32) {  
+                count += 4;
+            } else {                            
+                count += 3;
+            }
+        }
+        return count;
+    }
+
+    // u32_length
+
+    template <typename InputIt>
+    typename std::enable_if<(is_char8<typename std::iterator_traits<InputIt>::value_type>::value || is_char16<typename std::iterator_traits<InputIt>::value_type>::value),
+                                   std::size_t>::type 
+    u32_length(InputIt first, InputIt last) noexcept
+    {
+        std::size_t count = 0;
+        while (first != last)
+        {
+            if (detail::is_ascii_unit(*first))
+            {
+                InputIt run_last = detail::skip_ascii(first, last);
+                count += static_cast<std::size_t>(run_last - first);
+                first = run_last;
+                continue;
+            }
+            sequence_generator<InputIt> g(first, last, unicons::conv_flags::strict);
+            if (g.done())
+            {
+                break;
+            }
+            first += g.get().length();
+            ++count;
+        }
+        return count;
+    }
+
+    template <typename InputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,
+                                   std::size_t>::type 
+    u32_length(InputIt first, InputIt last) noexcept
+    {
+        return std::distance(first,last);
+    }
+
+    template <typename Iterator>
+    std::size_t u32_length(const valid_view<Iterator>& view) noexcept
+    {
+        std::size_t count = 0;
+        for (Iterator it = view.begin(); it != view.end(); ++it)
+        {
+            count += detail::is_trailing_unit(*it) ? 0 : 1;
+        }
+        return count;
+    }
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    enum class encoding {u8,u16le,u16be,u32le,u32be,undetected,
+                         latin1,windows1251,windows1252,iso8859_2,iso8859_5,iso8859_15,koi8_r};
+
+    template <typename Iterator>
+    struct detect_encoding_result
+    {
+        Iterator it;
+        encoding ec;
+    };
+
+    template <typename Iterator>
+    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char8<typename std::iterator_traits<Iterator>::value_type>::value,
+                            detect_encoding_result<Iterator>>::type 
+    detect_encoding(Iterator first, Iterator last) noexcept
+    {
+        Iterator it1 = first;
+        if (std::distance(first,last) < 4)
+        {
+            if (std::distance(first,last) == 3)
+            {
+                Iterator it2 = ++first;
+                Iterator it3 = ++first;
+                if (static_cast<uint8_t>(*it1) == 0xEF && static_cast<uint8_t>(*it2) == 0xBB && static_cast<uint8_t>(*it3) == 0xBF)
+                {
+                    return detect_encoding_result<Iterator>{last,encoding::u8};
+                }
+            }
+            return detect_encoding_result<Iterator>{it1,encoding::undetected};
+        }
+        else
+        {
+            Iterator it2 = ++first;
+            Iterator it3 = ++first;
+            Iterator it4 = ++first;
+
+            uint32_t bom = static_cast<uint8_t>(*it1) | (static_cast<uint8_t>(*it2) << 8) | (static_cast<uint8_t>(*it3) << 16) | (static_cast<uint8_t>(*it4) << 24);
+            if (bom == 0xFFFE0000)                  
+            { 
+                return detect_encoding_result<Iterator>{it4++,encoding::u32be};
+            }
+            else if (bom == 0x0000FEFF) 
+            {
+                return detect_encoding_result<Iterator>{first,encoding::u32le};
+            }
+            else if ((bom & 0xFFFF) == 0xFFFE)     
+            {
+                return detect_encoding_result<Iterator>{it3,encoding::u16be};
+            }
+            else if ((bom & 0xFFFF) == 0xFEFF)      
+            {
+                return detect_encoding_result<Iterator>{it3,encoding::u16le};
+            }
+            else if ((bom & 0xFFFFFF) == 0xBFBBEF)  
+            {
+                return detect_encoding_result<Iterator>{it4,encoding::u8};
+            }
+            else
+            {
+                uint32_t pattern = (static_cast<uint8_t>(*it1) ? 1 : 0) | (static_cast<uint8_t>(*it2) ? 2 : 0) | (static_cast<uint8_t>(*it3) ? 4 : 0) | (static_cast<uint8_t>(*it4) ? 8 : 0);
+                switch (pattern) {
+                case 0x08: 
+                    return detect_encoding_result<Iterator>{it1,encoding::u32be};
+                case 0x0A: 
+                    return detect_encoding_result<Iterator>{it1,encoding::u16be};
+                case 0x01: 
+                    return detect_encoding_result<Iterator>{it1,encoding::u32le};
+                case 0x05: 
+                    return detect_encoding_result<Iterator>{it1,encoding::u16le};
+                case 0x0F: 
+                    return detect_encoding_result<Iterator>{it1,encoding::u8};
+                default:
+                    return detect_encoding_result<Iterator>{it1,encoding::undetected};
+                }
+            }
+        }
+    }
+
+    template <typename Iterator>
+    struct skip_bom_result
+    {
+        Iterator it;
+        encoding_errc ec;
+    };
+
+    template <typename Iterator>
+    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char8<typename std::iterator_traits<Iterator>::value_type>::value,
+                                   skip_bom_result<Iterator>>::type 
+    skip_bom(Iterator first, Iterator last) noexcept
+    {
+        auto result = unicons::detect_encoding(first,last);
+        switch (result.ec)
+        {
+        case unicons::encoding::u8:
+            return skip_bom_result<Iterator>{result.it,encoding_errc()};
+            break;
+        case unicons::encoding::u16le:
+        case unicons::encoding::u16be:
+            return skip_bom_result<Iterator>{result.it,encoding_errc::expected_u8_found_u16};
+            break;
+        case unicons::encoding::u32le:
+        case unicons::encoding::u32be:
+            return skip_bom_result<Iterator>{result.it,encoding_errc::expected_u8_found_u32};
+            break;
+        default:
+            return skip_bom_result<Iterator>{result.it,encoding_errc()};
+            break;
+        }
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char16<typename std::iterator_traits<Iterator>::value_type>::value,
+                                   skip_bom_result<Iterator>>::type 
+    skip_bom(Iterator first, Iterator last) noexcept
+    {
+        if (first == last)
+        {
+            return skip_bom_result<Iterator>{first,encoding_errc()};
+        }
+        uint16_t bom = static_cast<uint16_t>(*first);
+        if (bom == 0xFEFF)                  
+        {
+            return skip_bom_result<Iterator>{++first,encoding_errc()};
+        }
+        else if (bom == 0xFFFE) 
+        {
+            return skip_bom_result<Iterator>{last,encoding_errc::expected_u16_found_fffe};
+        }
+        else
+        {
+            return skip_bom_result<Iterator>{first,encoding_errc()};
+        }
+    }
+
+    template <typename Iterator>
+    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char32<typename std::iterator_traits<Iterator>::value_type>::value,
+                            skip_bom_result<Iterator>>::type 
+    skip_bom(Iterator first, Iterator last) noexcept
+    {
+        if (first == last)
+        {
+            return skip_bom_result<Iterator>{first,encoding_errc()};
+        }
+        uint32_t bom = static_cast<uint32_t>(*first);
+        if (bom == 0xFEFF0000)                  
+        {
+            return skip_bom_result<Iterator>{++first,encoding_errc()};
+        }
+        else if (bom == 0xFFFE0000) 
+        {
+            return skip_bom_result<Iterator>{last,encoding_errc::expected_u32_found_fffe};
+        }
+        else
+        {
+            return skip_bom_result<Iterator>{first,encoding_errc()};
+        }
+    }
+
+    // byte order
+
+    // Tags for UTF-16 and UTF-32 in a range of bytes in a given byte order
+
+    struct utf16le_t {};
+    struct utf16be_t {};
+    struct utf32le_t {};
+    struct utf32be_t {};
+
+    constexpr utf16le_t utf16le{};
+    constexpr utf16be_t utf16be{};
+    constexpr utf32le_t utf32le{};
+    constexpr utf32be_t utf32be{};
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr bool big_endian_host = true;
+#else
+    constexpr bool big_endian_host = false;
+#endif
+
+    template <typename Tag>
+    struct byte_order_traits {};
+
+    template <>
+    struct byte_order_traits<utf16le_t>
+    {
+        typedef uint16_t code_unit;
+        static constexpr bool big_endian = false;
+    };
+
+    template <>
+    struct byte_order_traits<utf16be_t>
     {
-        conv_errc  result = conv_errc();
+        typedef uint16_t code_unit;
+        static constexpr bool big_endian = true;
+    };
 
-        while (first != last) 
+    template <>
+    struct byte_order_traits<utf32le_t>
+    {
+        typedef uint32_t code_unit;
+        static constexpr bool big_endian = false;
+    };
+
+    template <>
+    struct byte_order_traits<utf32be_t>
+    {
+        typedef uint32_t code_unit;
+        static constexpr bool big_endian = true;
+    };
+
+    template <typename Tag, typename InputIt, typename Enable=void>
+    struct is_byte_order_source : std::false_type {};
+
+    template <typename Tag, typename InputIt>
+    struct is_byte_order_source<Tag,InputIt,
+        typename std::enable_if<std::is_same<Tag,utf16le_t>::value || std::is_same<Tag,utf16be_t>::value ||
+                                std::is_same<Tag,utf32le_t>::value || std::is_same<Tag,utf32be_t>::value>::type>
+        : is_char8<typename std::iterator_traits<InputIt>::value_type> {};
+
+    // Bytes are read into a block of code units on the stack, and converted
+    // or validated from there with the code for native code units
+    constexpr std::size_t byte_order_block_size = 1024;
+
+    inline void swap_bytes(uint16_t* data, std::size_t length) noexcept
+    {
+        std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+        const __m128i shuffle = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+        for (; length - pos >= 8; pos += 8)
         {
-            uint32_t ch = *first++;
-            if (ch <= max_bmp) { /* Target is a character <= 0xFFFF */
-                /* UTF-16 surrogate values are illegal in UTF-32; 0xffff or 0xfffe are both reserved values */
-                if (is_surrogate(ch) ) {
-                    if (flags == conv_flags::strict) {
-                        --first; /* return to the illegal value itself */
-                        result = conv_errc::source_illegal;
-                        break;
-                    } else {
-                        *target++ = (replacement_char);
-                    }
-                } else {
-                    *target++ = ((uint16_t)ch); /* normal case */
-                }
-            } else if (ch > max_legal_utf32) {
-                if (flags == conv_flags::strict) {
-                    result = conv_errc::source_illegal;
-                } else {
-                    *target++ = (replacement_char);
-                }
-            } else {
-                /* target is a character in range 0xFFFF - 0x10FFFF. */
-                ch -= half_base;
-                *target++ = ((uint16_t)((ch >> half_shift) + sur_high_start));
-                *target++ = ((uint16_t)((ch & half_mask) + sur_low_start));
-            }
+            __m128i* p = reinterpret_cast<__m128i*>(data + pos);
+            _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), shuffle));
+        }
+#endif
+        for (; pos < length; ++pos)
+        {
+            data[pos] = static_cast<uint16_t>((data[pos] >> 8) | (data[pos] << 8));
         }
-        return convert_result<InputIt>{first,result} ;
     }
 
-    template <typename InputIt,class OutputIt>
-    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
-                                   && is_compatible_output_iterator<OutputIt,uint32_t>::value,convert_result<InputIt>>::type 
-    convert(InputIt first, InputIt last, 
-            OutputIt target, 
-            conv_flags flags = conv_flags::strict) 
+    inline void swap_bytes(uint32_t* data, std::size_t length) noexcept
     {
-        conv_errc  result = conv_errc();
-
-        while (first != last) 
+        std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+        const __m128i shuffle = _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+        for (; length - pos >= 4; pos += 4)
         {
-            uint32_t ch = *first++;
-            if (flags == conv_flags::strict ) {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_surrogate(ch)) {
-                    --first; /* return to the illegal value itself */
-                    result = conv_errc::illegal_surrogate_value;
-                    break;
-                }
-            }
-            if (ch <= max_legal_utf32)
-            {
-                *target++ = (ch);
-            }
-            else
-            {
-                *target++ = (replacement_char);
-                result = conv_errc::source_illegal;
-            }
+            __m128i* p = reinterpret_cast<__m128i*>(data + pos);
+            _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), shuffle));
+        }
+#endif
+        for (; pos < length; ++pos)
+        {
+            const uint32_t ch = data[pos];
+            data[pos] = (ch >> 24) | ((ch >> 8) & 0xFF00u) | ((ch << 8) & 0xFF0000u) | (ch << 24);
         }
-        return convert_result<InputIt>{first,result} ;
     }
 
-    // validate
+    // Reads length code units from the bytes at first
 
-    template <typename InputIt>
-    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
-                                   ,convert_result<InputIt>>::type 
-    validate(InputIt first, InputIt last) noexcept
+    template <typename Tag, typename InputIt>
+    typename std::enable_if<is_contiguous_iterator<InputIt>::value>::type
+    load_units(InputIt first, std::size_t length, typename byte_order_traits<Tag>::code_unit* buffer) noexcept
     {
-        conv_errc  result = conv_errc();
-        while (first != last) 
+        std::memcpy(buffer, std::addressof(*first), length*sizeof(*buffer));
+        if (byte_order_traits<Tag>::big_endian != big_endian_host)
         {
-            std::size_t length = static_cast<std::size_t>(trailing_bytes_for_utf8[static_cast<uint8_t>(*first)]) + 1;
-            if (length > (std::size_t)(last - first))
-            {
-                return convert_result<InputIt>{first, conv_errc::source_exhausted};
-            }
-            if ((result=is_legal_utf8(first, length)) != conv_errc())
-            {
-                return convert_result<InputIt>{first,result} ;
-            }
-            first += length;
+            swap_bytes(buffer, length);
         }
-        return convert_result<InputIt>{first,result} ;
     }
 
-    // utf16
-
-    template <typename InputIt>
-    typename std::enable_if<is_char16<typename std::iterator_traits<InputIt>::value_type>::value
-                                   ,convert_result<InputIt>>::type 
-    validate(InputIt first, InputIt last)  noexcept
+    template <typename Tag, typename InputIt>
+    typename std::enable_if<!is_contiguous_iterator<InputIt>::value>::type
+    load_units(InputIt first, std::size_t length, typename byte_order_traits<Tag>::code_unit* buffer)
     {
-        conv_errc  result = conv_errc();
-
-        while (first != last) 
+        typedef typename byte_order_traits<Tag>::code_unit code_unit;
+        for (std::size_t i = 0; i < length; ++i)
         {
-            uint32_t ch = *first++;
-            /* If we have a surrogate pair, validate to uint32_t first. */
-            if (is_high_surrogate(ch)) 
-            {
-                /* If the 16 bits following the high surrogate are in the first buffer... */
-                if (first < last) {
-                    uint32_t ch2 = *first;
-                    /* If it's a low surrogate, */
-                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
-                        ++first;
-                    } else {
-                        --first; /* return to the illegal value itself */
-                        result = conv_errc::unpaired_high_surrogate;
-                        break;
-                    }
-                } else { /* We don't have the 16 bits following the high surrogate. */
-                    --first; /* return to the high surrogate */
-                    result = conv_errc::source_exhausted;
-                    break;
-                }
-            } else if (is_low_surrogate(ch)) 
+            code_unit unit = 0;
+            for (std::size_t j = 0; j < sizeof(code_unit); ++j, ++first)
             {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                --first; /* return to the illegal value itself */
-                result = conv_errc::source_illegal;
-                break;
+                const code_unit byte = static_cast<uint8_t>(*first);
+                unit = byte_order_traits<Tag>::big_endian ? static_cast<code_unit>((unit << 8) | byte) 
+                                                          : static_cast<code_unit>(unit | (byte << (8*j)));
             }
+            buffer[i] = unit;
         }
-        return convert_result<InputIt>{first,result} ;
     }
 
+    // Reads the next block of code units. A high surrogate at the end of a
+    // block is left for the next block, so that a block never ends in the 
+    // middle of a sequence, except at the end of the range.
+    template <typename Tag, typename InputIt>
+    std::size_t load_block(InputIt first, std::size_t remaining, typename byte_order_traits<Tag>::code_unit* buffer)
+    {
+        std::size_t length = (std::min)(remaining, byte_order_block_size);
+        load_units<Tag>(first, length, buffer);
+        if (sizeof(*buffer) == 2 && length < remaining && is_high_surrogate(buffer[length-1]))
+        {
+            --length;
+        }
+        return length;
+    }
 
-    // utf32
+    // The number of whole code units in a range of bytes
+    template <typename Tag, typename InputIt>
+    std::size_t units_in(InputIt first, InputIt last)
+    {
+        return static_cast<std::size_t>(std::distance(first, last)) / sizeof(typename byte_order_traits<Tag>::code_unit);
+    }
 
+} // namespace detail
 
-    template <typename InputIt>
-    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value
-                                   ,convert_result<InputIt>>::type 
-    validate(InputIt first, InputIt last) noexcept
+    template <typename Tag,typename InputIt,typename OutputIt>
+    typename std::enable_if<detail::is_byte_order_source<Tag,InputIt>::value
+                            && is_compatible_output_iterator<OutputIt,typename detail::output_code_unit<OutputIt>::type>::value,
+                            convert_result<InputIt>>::type 
+    convert(Tag, InputIt first, InputIt last, OutputIt target, conv_flags flags = conv_flags::strict)
     {
-        conv_errc  result = conv_errc();
+        typedef typename detail::byte_order_traits<Tag>::code_unit code_unit;
 
-        while (first != last) 
+        code_unit buffer[detail::byte_order_block_size];
+        std::size_t remaining = detail::units_in<Tag>(first, last);
+        conv_errc result = conv_errc();
+        while (remaining > 0)
         {
-            uint32_t ch = *first++;
-            /* UTF-16 surrogate values are illegal in UTF-32 */
-            if (is_surrogate(ch)) {
-                --first; /* return to the illegal value itself */
-                result = conv_errc::illegal_surrogate_value;
-                break;
+            const std::size_t length = detail::load_block<Tag>(first, remaining, buffer);
+            convert_result<code_unit*> r = detail::convert_advance(buffer, buffer + length, target, flags);
+            if (r.it != buffer + length)
+            {
+                return convert_result<InputIt>{std::next(first, (r.it - buffer)*sizeof(code_unit)),r.ec};
             }
-            if (!(ch <= max_legal_utf32))
+            if (r.ec != conv_errc())
             {
-                result = conv_errc::source_illegal;
+                result = r.ec;
             }
+            std::advance(first, length*sizeof(code_unit));
+            remaining -= length;
         }
-        return convert_result<InputIt>{first,result} ;
+        // An error in the code units is reported before a part of a code unit at the end
+        if (first != last && result == conv_errc())
+        {
+            return convert_result<InputIt>{first,conv_errc::source_exhausted};
+        }
+        return convert_result<InputIt>{first,result};
     }
 
-    // sequence 
+    template <typename Tag,typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<detail::is_byte_order_source<Tag,InputIt>::value
+                            && is_character<CharT>::value,
+                            convert_result<InputIt>>::type 
+    convert(Tag tag, InputIt first, InputIt last, std::ostreambuf_iterator<CharT,Traits> target, conv_flags flags = conv_flags::strict)
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(tag, first, last, detail::ostreambuf_inserter<CharT,Traits>(block), flags);
+        block.flush();
+        return result;
+    }
 
-    template <typename Iterator>
-    class sequence
+    template <typename Tag,typename InputIt>
+    typename std::enable_if<detail::is_byte_order_source<Tag,InputIt>::value,convert_result<InputIt>>::type 
+    validate(Tag, InputIt first, InputIt last) noexcept
     {
-        Iterator first_;
-        std::size_t length_;
-    public:
-        sequence(Iterator first, std::size_t length)
-            : first_(first), length_(length)
-        {
-        }
+        typedef typename detail::byte_order_traits<Tag>::code_unit code_unit;
 
-        Iterator begin() const
+        code_unit buffer[detail::byte_order_block_size];
+        std::size_t remaining = detail::units_in<Tag>(first, last);
+        while (remaining > 0)
         {
-            return first_;
+            const std::size_t length = detail::load_block<Tag>(first, remaining, buffer);
+            convert_result<code_unit*> r = validate(buffer, buffer + length);
+            if (r.ec != conv_errc())
+            {
+                return convert_result<InputIt>{std::next(first, (r.it - buffer)*sizeof(code_unit)),r.ec};
+            }
+            std::advance(first, length*sizeof(code_unit));
+            remaining -= length;
         }
-
-        std::size_t length() const
+        if (first != last)
         {
-            return length_;
+            return convert_result<InputIt>{first,conv_errc::source_exhausted};
         }
+        return convert_result<InputIt>{first,conv_errc()};
+    }
 
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char8<CharT>::value,uint32_t>::type 
-        codepoint() const noexcept
+    template <typename Tag,typename InputIt>
+    typename std::enable_if<detail::is_byte_order_source<Tag,InputIt>::value,std::size_t>::type 
+    u8_length(Tag, InputIt first, InputIt last) noexcept
+    {
+        typedef typename detail::byte_order_traits<Tag>::code_unit code_unit;
+
+        code_unit buffer[detail::byte_order_block_size];
+        std::size_t remaining = detail::units_in<Tag>(first, last);
+        std::size_t count = 0;
+        while (remaining > 0)
         {
-            uint32_t ch = 0;
-            Iterator it = first_;
-            switch (length_) 
+            const std::size_t length = detail::load_block<Tag>(first, remaining, buffer);
+            if (sizeof(code_unit) == 4)
             {
-            default:
-                return replacement_char;
-                break;
-            case 4:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 3:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 2:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 1:
-                ch += static_cast<uint8_t>(*it++);
-                ch -= offsets_from_utf8[length_ - 1];
-                break;
+                count += u8_length(buffer, buffer + length);
             }
-            if (ch <= max_legal_utf32) 
+            else
             {
-                if (is_surrogate(ch)) 
+                // stops where u8_length stops, at the first error
+                convert_result<code_unit*> r = validate(buffer, buffer + length);
+                count += u8_length(buffer, r.it);
+                if (r.ec != conv_errc())
                 {
-                    ch = replacement_char;
+                    break;
                 }
             }
-            else // ch > max_legal_utf32
-            {
-                ch = replacement_char;
-            }
-            return ch;
-        }
-
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char16<CharT>::value,uint32_t>::type 
-        codepoint() const noexcept
-        {
-            if (length_ == 0)
-            {
-                return replacement_char;
-            }
-            if (length_ == 2)
-            {
-                uint32_t ch = *first_;
-                uint32_t ch2 = *(first_+ 1);
-                ch = ((ch - sur_high_start) << half_shift)
-                     + (ch2 - sur_low_start) + half_base;
-                return ch;
-            }
-            else 
-            {
-                return *first_;
-            }
-        }
-
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char32<CharT>::value,uint32_t>::type 
-        codepoint() const noexcept
-        {
-            if (length_ == 0)
-            {
-                return replacement_char;
-            }
-            return *(first_);
+            std::advance(first, length*sizeof(code_unit));
+            remaining -= length;
         }
-    };
-
-    // sequence_generator
+        return count;
+    }
 
-    template <typename Iterator>
-    class sequence_generator
+    template <typename Tag,typename InputIt>
+    typename std::enable_if<detail::is_byte_order_source<Tag,InputIt>::value,std::size_t>::type 
+    u32_length(Tag, InputIt first, InputIt last) noexcept
     {
-        Iterator begin_;
-        Iterator last_;
-        conv_flags flags_;
-        std::size_t length_;
-        conv_errc err_cd_;
-    public:
-        using sequence_type = sequence<Iterator>;
-
-        sequence_generator(Iterator first, Iterator last, 
-                           conv_flags flags = conv_flags::strict) noexcept
-            : begin_(first), last_(last), flags_(flags), 
-              length_(0), err_cd_(conv_errc())
+        typedef typename detail::byte_order_traits<Tag>::code_unit code_unit;
+
+        if (sizeof(code_unit) == 4)
         {
-            next();
+            return detail::units_in<Tag>(first, last);
         }
-
-        bool done() const noexcept
+        code_unit buffer[detail::byte_order_block_size];
+        std::size_t remaining = detail::units_in<Tag>(first, last);
+        std::size_t count = 0;
+        while (remaining > 0)
         {
-            return err_cd_ != conv_errc() || begin_ == last_;
+            const std::size_t length = detail::load_block<Tag>(first, remaining, buffer);
+            // stops where u32_length stops, at the first error
+            convert_result<code_unit*> r = validate(buffer, buffer + length);
+            count += u32_length(buffer, r.it);
+            if (r.ec != conv_errc())
+            {
+                break;
+            }
+            std::advance(first, length*sizeof(code_unit));
+            remaining -= length;
         }
+        return count;
+    }
 
-        conv_errc status() const noexcept
+} // namespace UNICONS_SIMD_NAMESPACE
+
+    // Latin-1
+
+    // Tag for ISO-8859-1 in a range of bytes, where each byte is the codepoint
+    // of the same value
+
+    struct latin1_t {};
+
+    constexpr latin1_t latin1{};
+
+inline namespace UNICONS_SIMD_NAMESPACE {
+
+namespace detail {
+
+    // Latin-1 to UTF-8, UTF-16 or UTF-32. Every byte is a valid character.
+    template <typename CodeUnit>
+    struct latin1_decode_kernel;
+
+    // To UTF-8, blocks of ASCII are copied, and in other blocks each byte is 
+    // widened to a 16-bit lane and encoded as one or two bytes.
+    template <>
+    struct latin1_decode_kernel<uint8_t>
+    {
+        typedef uint8_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 2;
+
+        static std::size_t valid_prefix(const uint8_t*, std::size_t length) noexcept
         {
-            return err_cd_;
+            return length;
         }
 
-        sequence_type get() const noexcept
+        static std::size_t output_length(const uint8_t* data, std::size_t length) noexcept
         {
-            return sequence<Iterator>(begin_,length_);
+            std::size_t count = length;
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
+            {
+                count += static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos))))));
+            }
+#endif
+            for (; pos < length; ++pos)
+            {
+                count += data[pos] >> 7;
+            }
+            return count;
         }
 
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char8<CharT>::value>::type 
-        next() noexcept
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
         {
-            begin_ += length_;
-            if (begin_ != last_)
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            // A block stores 8 bytes at a time, some of which may be past its output.
+            // 8 more bytes give at least 8 more bytes of output to overwrite them.
+            while (length - pos >= 24)
             {
-                std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*begin_)] + 1;
-                if (length > (std::size_t)(last_ - begin_))
-                {
-                    err_cd_ = conv_errc::source_exhausted;
-                }
-                else if ((err_cd_ = is_legal_utf8(begin_, length)) != conv_errc())
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                if (_mm_movemask_epi8(input) == 0)
                 {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target), input);
+                    target += 16;
                 }
                 else
                 {
-                    length_ = length;
+                    target = encode_utf8_epi16(_mm_cvtepu8_epi16(input), target);
+                    target = encode_utf8_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(input, 8)), target);
                 }
+                pos += 16;
             }
-        }
-
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char16<CharT>::value>::type 
-        next() noexcept
-        {
-            begin_ += length_;
-            if (begin_ != last_)
+#endif
+            for (; pos < length; ++pos)
             {
-                if (begin_ != last_)
-                {
-
-                    Iterator it = begin_;
-
-                    uint32_t ch = *it++;
-                    /* If we have a surrogate pair, validate to uint32_t it. */
-                    if (is_high_surrogate(ch)) 
-                    {
-                        /* If the 16 bits following the high surrogate are in the it buffer... */
-                        if (it < last_) {
-                            uint32_t ch2 = *it;
-                            /* If it's a low surrogate, */
-                            if (ch2 >= sur_low_start && ch2 <= sur_low_end) 
-                            {
-                                ++it;
-                                length_ = 2;
-                            } 
-                            else 
-                            {
-                                err_cd_ = conv_errc::unpaired_high_surrogate;
-                            }
-                        } 
-                        else 
-                        { 
-                            // We don't have the 16 bits following the high surrogate.
-                            err_cd_ = conv_errc::source_exhausted;
-                        }
-                    } 
-                    else if (is_low_surrogate(ch)) 
-                    {
-                        /* leading low surrogate */
-                        err_cd_ = conv_errc::source_illegal;
-                    }
-                    else
-                    {
-                        length_ = 1;
-                    }
-                }
+                encode_valid<uint8_t>(data[pos], target);
             }
-        }
-
-        template <typename CharT = typename std::iterator_traits<Iterator>::value_type>
-        typename std::enable_if<is_char32<CharT>::value>::type 
-        next() noexcept
-        {
-            begin_ += length_;
-            length_ = 1;
+            return target;
         }
     };
 
-    template <typename Iterator>
-    sequence_generator<Iterator> make_sequence_generator(Iterator first, Iterator last,
-        conv_flags flags = conv_flags::strict)
-    {
-        return sequence_generator<Iterator>(first, last, flags);
-    }
-
-    template <typename InputIt>
-    typename std::enable_if<(is_char8<typename std::iterator_traits<InputIt>::value_type>::value || is_char16<typename std::iterator_traits<InputIt>::value_type>::value),
-                                   sequence<InputIt>>::type 
-    sequence_at(InputIt first, InputIt last, std::size_t index) 
+    template <>
+    struct latin1_decode_kernel<uint16_t>
     {
-        sequence_generator<InputIt> g(first, last, unicons::conv_flags::strict);
+        typedef uint8_t source_type;
+        typedef uint16_t target_type;
+        static constexpr std::size_t max_expansion = 1;
 
-        std::size_t count = 0;
-        while (!g.done() && count < index)
+        static std::size_t valid_prefix(const uint8_t*, std::size_t length) noexcept
         {
-            g.next();
-            ++count;
+            return length;
         }
-        return (!g.done() && count == index) ? g.get() : sequence<InputIt>(last,0);
-    }
 
-    template <typename InputIt>
-    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,
-                                   sequence<InputIt>>::type 
-    sequence_at(InputIt first, InputIt last, std::size_t index) 
-    {
-        std::size_t size = std::distance(first,last);
-        return index < size ? sequence<InputIt>(first+index,1) : sequence<InputIt>(last,0);
-    }
+        static std::size_t output_length(const uint8_t*, std::size_t length) noexcept
+        {
+            return length;
+        }
 
-    // codepoint_iterator
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_unpacklo_epi8(input, _mm_setzero_si128()));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), _mm_unpackhi_epi8(input, _mm_setzero_si128()));
+                target += 16;
+            }
+#endif
+            for (; pos < length; ++pos)
+            {
+                *target++ = data[pos];
+            }
+            return target;
+        }
+    };
 
-    template <typename Iter>
-    class codepoint_iterator
+    template <>
+    struct latin1_decode_kernel<uint32_t>
     {
-        Iter it_;
-        Iter last_;
-        conv_flags flags_;
-        std::size_t length_;
-    public:
-        using iterator_type = Iter;
-        using value_type = uint32_t;
-        using difference_type = std::ptrdiff_t;
-        using pointer = value_type*;
-        using reference = const value_type&;
-        using iterator_category = std::input_iterator_tag;
+        typedef uint8_t source_type;
+        typedef uint32_t target_type;
+        static constexpr std::size_t max_expansion = 1;
 
-        codepoint_iterator() noexcept
-            : length_(0)
+        static std::size_t valid_prefix(const uint8_t*, std::size_t length) noexcept
         {
+            return length;
         }
 
-        codepoint_iterator(Iter first, Iter last, 
-                           conv_flags flags = conv_flags::strict) 
-            : it_(first), last_(last), flags_(flags), length_(0)
+        static std::size_t output_length(const uint8_t*, std::size_t length) noexcept
         {
-            operator++();
+            return length;
         }
 
-        codepoint_iterator(Iter first, Iter last, 
-                           std::error_code& ec) noexcept
-            : codepoint_iterator(first, last, conv_flags::strict, ec)
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
         {
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_cvtepu8_epi32(input));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 4), _mm_cvtepu8_epi32(_mm_srli_si128(input, 4)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), _mm_cvtepu8_epi32(_mm_srli_si128(input, 8)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 12), _mm_cvtepu8_epi32(_mm_srli_si128(input, 12)));
+                target += 16;
+            }
+#endif
+            for (; pos < length; ++pos)
+            {
+                *target++ = data[pos];
+            }
+            return target;
         }
+    };
 
-        codepoint_iterator(Iter first, Iter last, 
-                           conv_flags flags, std::error_code& ec) noexcept
-            : it_(first), last_(last), flags_(flags), length_(0)
+    // UTF-8, UTF-16 or UTF-32 to Latin-1, for the prefix of codepoints below
+    // U+0100. The rest, from the first codepoint above U+00FF or the first 
+    // illegal sequence, is left to encode_codepoints.
+    template <typename CodeUnit>
+    struct latin1_encode_kernel;
+
+#if defined(UNICONS_SSE42)
+    // For a block of ASCII and the sequences C2 80 to C3 BF, puts the Latin-1 
+    // byte of each sequence in the lane of its lead byte, and the lanes to keep
+    // in keep. Returns the number of bytes decoded, 15 if the last sequence is
+    // cut off by the end of the block, or 0 if the block has other bytes.
+    inline std::size_t decode_latin1_pairs(__m128i input, __m128i& values, unsigned& keep) noexcept
+    {
+        const __m128i lead = _mm_cmpeq_epi8(_mm_and_si128(input, _mm_set1_epi8(static_cast<char>(0xFE))), _mm_set1_epi8(static_cast<char>(0xC2)));
+        const unsigned leads = static_cast<unsigned>(_mm_movemask_epi8(lead));
+        const unsigned continuations = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(input, _mm_set1_epi8(static_cast<char>(0xC0))), 
+                                                                                              _mm_set1_epi8(static_cast<char>(0x80)))));
+        if ((leads | continuations) != static_cast<unsigned>(_mm_movemask_epi8(input)) || ((leads << 1) & 0xFFFF) != continuations)
         {
-            increment(ec);
+            return 0;
         }
+        // C2 xx is xx, C3 xx is xx + 0x40
+        const __m128i next = _mm_srli_si128(input, 1);
+        const __m128i c3 = _mm_and_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8(static_cast<char>(0xC3))), _mm_set1_epi8(0x40));
+        values = _mm_blendv_epi8(input, _mm_add_epi8(next, c3), lead);
+        keep = ~(continuations | (leads & 0x8000)) & 0xFFFF;
+        return (leads & 0x8000) ? 15 : 16;
+    }
 
-        codepoint_iterator(const codepoint_iterator&) = default;
-
-        codepoint_iterator(codepoint_iterator&&) = default; 
-
-        codepoint_iterator& operator=(const codepoint_iterator&) = default;
-
-        codepoint_iterator& operator=(codepoint_iterator&&) = default;
+    // The number of bytes b in a block with (b & mask) == bits
+    inline std::size_t count_bytes_epi8(__m128i input, __m128i mask, __m128i bits) noexcept
+    {
+        return static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(input, mask), bits)))));
+    }
+#endif
 
-        constexpr iterator_type base() const noexcept
+    // The length of the sequence at data, if it is ASCII or C2 80 to C3 BF, 
+    // otherwise 0
+    inline std::size_t latin1_sequence_length(const uint8_t* data, std::size_t length) noexcept
+    {
+        if (data[0] < 0x80)
         {
-            return it_;
+            return 1;
         }
+        return (data[0] == 0xC2 || data[0] == 0xC3) && length >= 2 && (data[1] & 0xC0) == 0x80 ? 2 : 0;
+    }
 
-        uint32_t operator*() const noexcept
+    // Writes the Latin-1 byte of a valid sequence, returning its length
+    template <typename T>
+    std::size_t encode_latin1_sequence(const uint8_t* data, T*& target) noexcept
+    {
+        if (data[0] < 0x80)
         {
-            return get_codepoint();
+            *target++ = data[0];
+            return 1;
         }
+        *target++ = static_cast<uint8_t>((data[0] << 6) | (data[1] & 0x3F));
+        return 2;
+    }
 
-        codepoint_iterator& operator++()
+    // From UTF-8, blocks of 16 bytes of ASCII and the sequences C2 80 to C3 BF
+    // are decoded in place and the continuation bytes packed out. A block with
+    // a sequence cut off by its end is decoded a sequence at a time.
+    template <>
+    struct latin1_encode_kernel<uint8_t>
+    {
+        typedef uint8_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const uint8_t* data, std::size_t length) noexcept
         {
-            std::error_code ec;
-            increment(ec);
-            if (ec)
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            while (length - pos >= 16)
             {
-                UNICONS_THROW(unicode_error(ec));
+                __m128i values;
+                unsigned keep;
+                const std::size_t n = decode_latin1_pairs(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), values, keep);
+                if (n != 0)
+                {
+                    pos += n;
+                    continue;
+                }
+                const std::size_t block_end = pos + 16;
+                while (pos < block_end)
+                {
+                    const std::size_t n = latin1_sequence_length(data + pos, length - pos);
+                    if (n == 0)
+                    {
+                        return pos;
+                    }
+                    pos += n;
+                }
             }
-            return *this;
+#endif
+            while (pos < length)
+            {
+                const std::size_t n = latin1_sequence_length(data + pos, length - pos);
+                if (n == 0)
+                {
+                    break;
+                }
+                pos += n;
+            }
+            return pos;
         }
 
-        codepoint_iterator operator++(int) // postfix increment
+        static std::size_t output_length(const uint8_t* data, std::size_t length) noexcept
         {
-            codepoint_iterator temp(*this);
-            ++(*this);
-            return temp;
+            std::size_t count = length;
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
+            {
+                count -= count_bytes_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), 
+                                          _mm_set1_epi8(static_cast<char>(0xC0)), _mm_set1_epi8(static_cast<char>(0x80)));
+            }
+#endif
+            for (; pos < length; ++pos)
+            {
+                count -= (data[pos] & 0xC0) == 0x80;
+            }
+            return count;
         }
 
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char8<CharT>::value,codepoint_iterator& >::type 
-        increment(std::error_code& ec) noexcept
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
         {
-            it_ += length_;
-            if (it_ != last_)
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            // A block stores 8 bytes at a time, some of which may be past its output.
+            // 16 more bytes give at least 8 more bytes of output to overwrite them.
+            while (length - pos >= 32)
             {
-                std::size_t length = trailing_bytes_for_utf8[static_cast<uint8_t>(*it_)] + 1;
-                if (length > (std::size_t)(last_ - it_))
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                __m128i values;
+                unsigned keep;
+                std::size_t n;
+                if (_mm_movemask_epi8(input) == 0)
                 {
-                    ec = conv_errc::source_exhausted;
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target), input);
+                    target += 16;
+                    pos += 16;
+                }
+                else if ((n = decode_latin1_pairs(input, values, keep)) != 0)
+                {
+                    target = store_packed_epi8(values, keep, target);
+                    pos += n;
                 }
                 else
                 {
-                    ec = is_legal_utf8(it_, length);
-                    if (!ec)
+                    const std::size_t block_end = pos + 16;
+                    while (pos < block_end)
                     {
-                        length_ = length;
+                        pos += encode_latin1_sequence(data + pos, target);
                     }
                 }
             }
-            return *this;
+#endif
+            while (pos < length)
+            {
+                pos += encode_latin1_sequence(data + pos, target);
+            }
+            return target;
+        }
+    };
+
+    // From UTF-16, code units are narrowed 16 at a time.
+    template <>
+    struct latin1_encode_kernel<uint16_t>
+    {
+        typedef uint16_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const uint16_t* data, std::size_t length) noexcept
+        {
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 8; pos += 8)
+            {
+                if (!_mm_testz_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), _mm_set1_epi16(static_cast<short>(0xFF00))))
+                {
+                    break;
+                }
+            }
+#endif
+            while (pos < length && load_unit(data + pos) < 0x100)
+            {
+                ++pos;
+            }
+            return pos;
+        }
+
+        static std::size_t output_length(const uint16_t*, std::size_t length) noexcept
+        {
+            return length;
+        }
+
+        template <typename T>
+        static T* transcode(const uint16_t* data, std::size_t length, T* target) noexcept
+        {
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
+            {
+                const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(v0, v1));
+                target += 16;
+            }
+#endif
+            for (; pos < length; ++pos)
+            {
+                *target++ = static_cast<uint8_t>(load_unit(data + pos));
+            }
+            return target;
         }
+    };
 
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char16<CharT>::value,codepoint_iterator& >::type 
-        increment(std::error_code& ec) noexcept
+    // From UTF-32, code units are narrowed 16 at a time.
+    template <>
+    struct latin1_encode_kernel<uint32_t>
+    {
+        typedef uint32_t source_type;
+        typedef uint8_t target_type;
+        static constexpr std::size_t max_expansion = 1;
+
+        static std::size_t valid_prefix(const uint32_t* data, std::size_t length) noexcept
         {
-            it_ += length_;
-            if (it_ != last_)
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 4; pos += 4)
             {
-                if (it_ != last_)
+                if (!_mm_testz_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), _mm_set1_epi32(static_cast<int>(0xFFFFFF00))))
                 {
-
-                    Iter it = it_;
-
-                    uint32_t ch = *it++;
-                    /* If we have a surrogate pair, validate to uint32_t it. */
-                    if (is_high_surrogate(ch)) 
-                    {
-                        /* If the 16 bits following the high surrogate are in the it buffer... */
-                        if (it < last_) {
-                            uint32_t ch2 = *it;
-                            /* If it's a low surrogate, */
-                            if (ch2 >= sur_low_start && ch2 <= sur_low_end) 
-                            {
-                                ++it;
-                                length_ = 2;
-                            } 
-                            else 
-                            {
-                                ec = conv_errc::unpaired_high_surrogate;
-                            }
-                        } 
-                        else 
-                        { 
-                            // We don't have the 16 bits following the high surrogate.
-                            ec = conv_errc::source_exhausted;
-                        }
-                    } 
-                    else if (is_low_surrogate(ch)) 
-                    {
-                        /* leading low surrogate */
-                        ec = conv_errc::source_illegal;
-                    }
-                    else
-                    {
-                        length_ = 1;
-                    }
+                    break;
                 }
             }
-            return *this;
+#endif
+            while (pos < length && load_unit(data + pos) < 0x100)
+            {
+                ++pos;
+            }
+            return pos;
         }
 
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char32<CharT>::value,codepoint_iterator& >::type 
-        increment(std::error_code&) noexcept
+        static std::size_t output_length(const uint32_t*, std::size_t length) noexcept
         {
-            it_ += length_;
-            length_ = 1;
-            return *this;
+            return length;
         }
 
-        friend bool operator==(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+        template <typename T>
+        static T* transcode(const uint32_t* data, std::size_t length, T* target) noexcept
         {
-            if (rhs.is_end())
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
             {
-                return lhs.is_end();
+                const __m128i* p = reinterpret_cast<const __m128i*>(data + pos);
+                const __m128i low = _mm_packus_epi32(_mm_loadu_si128(p), _mm_loadu_si128(p + 1));
+                const __m128i high = _mm_packus_epi32(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(low, high));
+                target += 16;
             }
-            else
+#endif
+            for (; pos < length; ++pos)
             {
-                return lhs.it_ == rhs.it_;
+                *target++ = static_cast<uint8_t>(load_unit(data + pos));
             }
+            return target;
         }
+    };
 
-        friend bool operator!=(const codepoint_iterator& lhs, const codepoint_iterator& rhs) noexcept
+    // UTF-8, UTF-16 or UTF-32 to an encoding that is ASCII in the bytes 0x00 
+    // to 0x7F, for a run of ASCII
+    template <typename CodeUnit>
+    struct ascii_encode_kernel : latin1_encode_kernel<CodeUnit>
+    {
+        static std::size_t valid_prefix(const CodeUnit* data, std::size_t length) noexcept
         {
-            return !(lhs == rhs);
+            return ascii_prefix(data, length);
         }
 
-        bool is_end() const noexcept
+        static std::size_t output_length(const CodeUnit*, std::size_t length) noexcept
         {
-            return length_ == 0 || it_ == last_;
+            return length;
         }
+    };
 
-    private:
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char8<CharT>::value,uint32_t>::type 
-        get_codepoint() const noexcept
+    // Encodes a range a codepoint at a time with an encoder that writes a 
+    // codepoint to the target and returns true, or returns false if the target
+    // encoding has no character for it. UTF-8 and UTF-16 are decoded to UTF-32
+    // a window of code units at a time, which holds at most as many codepoints,
+    // and each block of codepoints is encoded to bytes on the stack. If the 
+    // encoder writes ASCII as is, each run of ASCII is copied with 
+    // ascii_encode_kernel, and a window ends after the first ASCII code unit.
+
+    constexpr std::size_t codepoint_block_size = 256;
+
+    // The most bytes that an encoder writes for a codepoint
+    constexpr std::size_t max_encoded_length = 4;
+
+    // Whether an encoder writes each codepoint below U+0080 as that byte
+    template <typename Encoder>
+    struct is_ascii_encoder : std::false_type {};
+
+    // Copies the run of ASCII at the start of [first, last) as bytes
+    template <typename InputIt, typename OutputIt>
+    InputIt encode_ascii(InputIt first, InputIt last, OutputIt& target)
+    {
+        typedef typename code_unit_type<typename std::iterator_traits<InputIt>::value_type>::type code_unit;
+
+        first = transcode_prefix<ascii_encode_kernel<code_unit>>(first, last, target);
+        return copy_ascii<uint8_t>(first, last, target);
+    }
+
+    // The end of the next window, at most codepoint_block_size code units
+    template <typename Encoder, typename InputIt>
+    typename std::enable_if<is_ascii_encoder<Encoder>::value,InputIt>::type
+    window_end(InputIt first, InputIt last)
+    {
+        for (std::size_t n = 0; first != last && n < codepoint_block_size; ++n)
         {
-            uint32_t ch = 0;
-            Iter it = it_;
-            switch (length_) 
+            if (is_ascii_unit(*first++))
             {
-            default:
-                return replacement_char;
-                break;
-            case 4:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 3:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 2:
-                ch += static_cast<uint8_t>(*it++); ch <<= 6;
-                UNICONS_FALLTHROUGH;
-            case 1:
-                ch += static_cast<uint8_t>(*it++);
-                ch -= offsets_from_utf8[length_ - 1];
                 break;
             }
-            if (ch <= max_legal_utf32) 
+        }
+        return first;
+    }
+
+    template <typename Encoder, typename InputIt>
+    typename std::enable_if<!is_ascii_encoder<Encoder>::value,InputIt>::type
+    window_end(InputIt first, InputIt last)
+    {
+        return std::next(first, (std::min)(static_cast<std::size_t>(std::distance(first, last)), codepoint_block_size));
+    }
+
+    template <typename InputIt, typename OutputIt, typename Encoder>
+    typename std::enable_if<!is_char32<typename std::iterator_traits<InputIt>::value_type>::value,convert_result<InputIt>>::type
+    encode_codepoints(InputIt first, InputIt last, OutputIt& target, Encoder encoder)
+    {
+        uint32_t codepoints[codepoint_block_size];
+        uint8_t bytes[codepoint_block_size*max_encoded_length];
+        while (first != last)
+        {
+            if (is_ascii_encoder<Encoder>::value && is_ascii_unit(*first))
             {
-                if (is_surrogate(ch)) 
+                first = encode_ascii(first, last, target);
+                continue;
+            }
+            InputIt window_last = window_end<Encoder>(first, last);
+            uint32_t* end = codepoints;
+            convert_result<InputIt> r = convert_advance(first, window_last, end, conv_flags::strict);
+            uint8_t* out = bytes;
+            for (const uint32_t* p = codepoints; p != end; ++p)
+            {
+                if (!encoder(*p, out))
                 {
-                    ch = replacement_char;
+                    target = std::copy(bytes, out, target);
+                    for (const uint32_t* q = codepoints; q != p; ++q)
+                    {
+                        std::advance(first, sequence_length(*first));
+                    }
+                    return convert_result<InputIt>{first,conv_errc::unmappable_character};
                 }
             }
-            else // ch > max_legal_utf32
+            target = std::copy(bytes, out, target);
+            if (r.ec != conv_errc() && !is_cut_off(r, window_last, last))
             {
-                ch = replacement_char;
+                return convert_result<InputIt>{r.it,r.ec};
             }
-            return ch;
+            // A window that ends after an ASCII code unit may hold only a sequence
+            // that looks cut off, but has that ASCII code unit inside it. The error
+            // is the one for the whole sequence.
+            if (r.ec != conv_errc() && r.it == first)
+            {
+                uint32_t* p = codepoints;
+                r = convert_advance(first, sequence_end(first, last), p, conv_flags::strict);
+                return convert_result<InputIt>{r.it,r.ec};
+            }
+            first = r.it;
         }
+        return convert_result<InputIt>{first,conv_errc()};
+    }
 
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char16<CharT>::value,uint32_t>::type 
-        get_codepoint() const noexcept
+    template <typename InputIt, typename OutputIt, typename Encoder>
+    typename std::enable_if<is_char32<typename std::iterator_traits<InputIt>::value_type>::value,convert_result<InputIt>>::type
+    encode_codepoints(InputIt first, InputIt last, OutputIt& target, Encoder encoder)
+    {
+        while (first != last)
         {
-            if (length_ == 0)
+            const uint32_t ch = static_cast<uint32_t>(*first);
+            if (is_ascii_encoder<Encoder>::value && ch < 0x80)
             {
-                return replacement_char;
+                first = encode_ascii(first, last, target);
+                continue;
             }
-            if (length_ == 2)
+            if (is_surrogate(ch))
             {
-                uint32_t ch = *it_;
-                uint32_t ch2 = *(it_+ 1);
-                ch = ((ch - sur_high_start) << half_shift)
-                     + (ch2 - sur_low_start) + half_base;
-                return ch;
+                return convert_result<InputIt>{first,conv_errc::illegal_surrogate_value};
             }
-            else 
+            if (ch > max_legal_utf32)
             {
-                return *it_;
+                return convert_result<InputIt>{first,conv_errc::source_illegal};
+            }
+            if (!encoder(ch, target))
+            {
+                return convert_result<InputIt>{first,conv_errc::unmappable_character};
             }
+            ++first;
         }
+        return convert_result<InputIt>{first,conv_errc()};
+    }
 
-        template <typename CharT = typename std::iterator_traits<Iter>::value_type>
-        typename std::enable_if<is_char32<CharT>::value,uint32_t>::type 
-        get_codepoint() const noexcept
+    struct latin1_encoder
+    {
+        template <typename OutputIt>
+        bool operator()(uint32_t ch, OutputIt& target) const
         {
-            if (length_ == 0)
+            if (ch > 0xFF)
             {
-                return replacement_char;
+                return false;
             }
-            return *(it_);
+            *target++ = static_cast<uint8_t>(ch);
+            return true;
         }
-
     };
 
-    template <typename InputIt>
-    inline const codepoint_iterator<InputIt>& begin(const codepoint_iterator<InputIt>& iter) noexcept { return iter; }
+} // namespace detail
 
-    template <typename InputIt>
-    inline codepoint_iterator<InputIt> end(const codepoint_iterator<InputIt>&) noexcept { return codepoint_iterator<InputIt>(); }
+    // Latin-1 to UTF-8, UTF-16 or UTF-32, by the code unit type of the target.
+    // Every byte is a character, so there are no errors.
 
-    template <typename Iter, typename... Args>
-    codepoint_iterator<Iter> make_codepoint_iterator(Iter first, Args&& ... args)
+    template <typename InputIt,typename OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,typename detail::output_code_unit<OutputIt>::type>::value,
+                            convert_result<InputIt>>::type 
+    convert(latin1_t, InputIt first, InputIt last, OutputIt target)
     {
-        return codepoint_iterator<Iter>(first, std::forward<Args>(args)...);
-    }
+        typedef typename detail::output_code_unit<OutputIt>::type code_unit;
 
-    template <typename Iter, typename Distance>
-    void advance(codepoint_iterator<Iter>& it, Distance n, std::error_code& ec) noexcept    
-    {
-        for (std::size_t i = 0; !ec && i < n; ++i)
+        first = detail::transcode_prefix<detail::latin1_decode_kernel<code_unit>>(first, last, target);
+        for (; first != last; ++first)
         {
-            it.increment(ec);
+            detail::encode_valid<code_unit>(static_cast<uint8_t>(*first), target);
         }
+        return convert_result<InputIt>{first,conv_errc()};
     }
 
-    // u8_length
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value,
+                            convert_result<InputIt>>::type 
+    convert(latin1_t tag, InputIt first, InputIt last, std::ostreambuf_iterator<CharT,Traits> target)
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(tag, first, last, detail::ostreambuf_inserter<CharT,Traits>(block));
+        block.flush();
+        return result;
+    }
 
-    template <typename InputIt>
-    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char8<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
-    u8_length(InputIt first, InputIt last) noexcept
+    // UTF-8, UTF-16 or UTF-32 to Latin-1. Stops at the first codepoint above 
+    // U+00FF with conv_errc::unmappable_character, or at the first illegal 
+    // sequence with the error that validate reports.
+
+    template <typename InputIt,typename OutputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,uint8_t>::value,
+                            convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, latin1_t, OutputIt target)
     {
-        return std::distance(first,last);
+        typedef typename detail::code_unit_type<typename std::iterator_traits<InputIt>::value_type>::type code_unit;
+
+        first = detail::transcode_prefix<detail::latin1_encode_kernel<code_unit>>(first, last, target);
+        return detail::encode_codepoints(first, last, target, detail::latin1_encoder());
     }
 
-    // utf16
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value && sizeof(CharT) == 1,
+                            convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, latin1_t tag, std::ostreambuf_iterator<CharT,Traits> target)
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(first, last, tag, detail::ostreambuf_inserter<CharT,Traits>(block));
+        block.flush();
+        return result;
+    }
 
-    template <typename InputIt>
-    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char16<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
-    u8_length(InputIt first, InputIt last) noexcept
+    // single byte codepages
+
+namespace detail {
+
+    // Bytes 0x00 to 0x7F are ASCII in every codepage. Each table maps the
+    // bytes 0x80 to 0xFF to BMP codepoints, with 0 for a byte that has no 
+    // character, and two bitmaps of the bytes 0x80 to 0xFF mark the bytes that
+    // have no character, and those that encode codepoints above 0x7FF. The 
+    // reverse mapping, ASCII included, is a table of pages of 256 codepoints,
+    // with a byte for each codepoint or 0, and an index from the high byte of
+    // a codepoint to its page plus one, or 0. Generated from the unicode.org 
+    // mapping files. The tables are static data members of a class template,
+    // so that they have one definition for all translation units.
+
+    template <class T = void>
+    struct codepage_data
     {
-        conv_flags flags = conv_flags::strict;
-        std::size_t count = 0;
-        for (InputIt p = first; p != last; ++p)
-        {
-            uint32_t ch = *p;
-            if (is_high_surrogate(ch)) {
-                /* If the 16 bits following the high surrogate are in the p buffer... */
-                if (p < last) {
-                    uint32_t ch2 = *(++p);
-                    /* If it's a low surrogate, convert to uint32_t. */
-                    if (ch2 >= sur_low_start && ch2 <= sur_low_end) {
-                        ch = ((ch - sur_high_start) << half_shift)
-                            + (ch2 - sur_low_start) + half_base;
-                   
-                    } else if (flags == conv_flags::strict) { /* it's an unpaired high surrogate */
-                        break;
-                    }
-                } else { /* We don't have the 16 bits following the high surrogate. */
-                    break;
-                }
-            } else if (flags == conv_flags::strict) {
-                /* UTF-16 surrogate values are illegal in UTF-32 */
-                if (is_low_surrogate(ch)) {
-                    break;
-                }
+        // Windows-1251
+
+        static constexpr uint16_t windows1251_to_unicode[128] = {
+            0x0402,0x0403,0x201A,0x0453,0x201E,0x2026,0x2020,0x2021,
+            0x20AC,0x2030,0x0409,0x2039,0x040A,0x040C,0x040B,0x040F,
+            0x0452,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+            0x0000,0x2122,0x0459,0x203A,0x045A,0x045C,0x045B,0x045F,
+            0x00A0,0x040E,0x045E,0x0408,0x00A4,0x0490,0x00A6,0x00A7,
+            0x0401,0x00A9,0x0404,0x00AB,0x00AC,0x00AD,0x00AE,0x0407,
+            0x00B0,0x00B1,0x0406,0x0456,0x0491,0x00B5,0x00B6,0x00B7,
+            0x0451,0x2116,0x0454,0x00BB,0x0458,0x0405,0x0455,0x0457,
+            0x0410,0x0411,0x0412,0x0413,0x0414,0x0415,0x0416,0x0417,
+            0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,0x041F,
+            0x0420,0x0421,0x0422,0x0423,0x0424,0x0425,0x0426,0x0427,
+            0x0428,0x0429,0x042A,0x042B,0x042C,0x042D,0x042E,0x042F,
+            0x0430,0x0431,0x0432,0x0433,0x0434,0x0435,0x0436,0x0437,
+            0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,0x043F,
+            0x0440,0x0441,0x0442,0x0443,0x0444,0x0445,0x0446,0x0447,
+            0x0448,0x0449,0x044A,0x044B,0x044C,0x044D,0x044E,0x044F
+        };
+
+        static constexpr uint8_t windows1251_undefined[16] = {0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t windows1251_above_07ff[16] = {0xF4,0x0B,0xFE,0x0A,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+        static constexpr uint8_t windows1251_page_index[256] = {
+            1,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            3,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t windows1251_pages[4][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xA0,0x00,0x00,0x00,0xA4,0x00,0xA6,0xA7,0x00,0xA9,0x00,0xAB,0xAC,0xAD,0xAE,0x00,
+                    0xB0,0xB1,0x00,0x00,0x00,0xB5,0xB6,0xB7,0x00,0x00,0x00,0xBB,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0xA8,0x80,0x81,0xAA,0xBD,0xB2,0xAF,0xA3,0x8A,0x8C,0x8E,0x8D,0x00,0xA1,0x8F,
+                    0xC0,0xC1,0xC2,0xC3,0xC4,0xC5,0xC6,0xC7,0xC8,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,
+                    0xD0,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,0xD7,0xD8,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,
+                    0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEF,
+                    0xF0,0xF1,0xF2,0xF3,0xF4,0xF5,0xF6,0xF7,0xF8,0xF9,0xFA,0xFB,0xFC,0xFD,0xFE,0xFF,
+                    0x00,0xB8,0x90,0x83,0xBA,0xBE,0xB3,0xBF,0xBC,0x9A,0x9C,0x9E,0x9D,0x00,0xA2,0x9F,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xA5,0xB4,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x96,0x97,0x00,0x00,0x00,0x91,0x92,0x82,0x00,0x93,0x94,0x84,0x00,
+                    0x86,0x87,0x95,0x00,0x00,0x00,0x85,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x89,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x8B,0x9B,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x88,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0xB9,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x99,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
             }
-            if (ch < (uint32_t)0x80) {      
-                ++count;
-            } else if (ch < (uint32_t)0x800) {     
-                count += 2;
-            } else if (ch < (uint32_t)0x10000) {   
-                count += 3;
-            } else if (ch < (uint32_t)0x110000) {  
-                count += 4;
-            } else {                            
-                count += 3;
+        };
+
+        // Windows-1252
+
+        static constexpr uint16_t windows1252_to_unicode[128] = {
+            0x20AC,0x0000,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+            0x02C6,0x2030,0x0160,0x2039,0x0152,0x0000,0x017D,0x0000,
+            0x0000,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+            0x02DC,0x2122,0x0161,0x203A,0x0153,0x0000,0x017E,0x0178,
+            0x00A0,0x00A1,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+            0x00A8,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+            0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+            0x00B8,0x00B9,0x00BA,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+            0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+            0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+            0x00D0,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+            0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x00DD,0x00DE,0x00DF,
+            0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+            0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+            0x00F0,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+            0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x00FD,0x00FE,0x00FF
+        };
+
+        static constexpr uint8_t windows1252_undefined[16] = {0x02,0xA0,0x01,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t windows1252_above_07ff[16] = {0xF5,0x0A,0xFE,0x0A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+        static constexpr uint8_t windows1252_page_index[256] = {
+            1,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            4,5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t windows1252_pages[5][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xA0,0xA1,0xA2,0xA3,0xA4,0xA5,0xA6,0xA7,0xA8,0xA9,0xAA,0xAB,0xAC,0xAD,0xAE,0xAF,
+                    0xB0,0xB1,0xB2,0xB3,0xB4,0xB5,0xB6,0xB7,0xB8,0xB9,0xBA,0xBB,0xBC,0xBD,0xBE,0xBF,
+                    0xC0,0xC1,0xC2,0xC3,0xC4,0xC5,0xC6,0xC7,0xC8,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,
+                    0xD0,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,0xD7,0xD8,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,
+                    0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEF,
+                    0xF0,0xF1,0xF2,0xF3,0xF4,0xF5,0xF6,0xF7,0xF8,0xF9,0xFA,0xFB,0xFC,0xFD,0xFE,0xFF
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x8C,0x9C,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x8A,0x9A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x9F,0x00,0x00,0x00,0x00,0x8E,0x9E,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x83,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x88,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x98,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x96,0x97,0x00,0x00,0x00,0x91,0x92,0x82,0x00,0x93,0x94,0x84,0x00,
+                    0x86,0x87,0x95,0x00,0x00,0x00,0x85,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x89,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x8B,0x9B,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x99,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            }
+        };
+
+        // ISO-8859-2
+
+        static constexpr uint16_t iso8859_2_to_unicode[128] = {
+            0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+            0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+            0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+            0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+            0x00A0,0x0104,0x02D8,0x0141,0x00A4,0x013D,0x015A,0x00A7,
+            0x00A8,0x0160,0x015E,0x0164,0x0179,0x00AD,0x017D,0x017B,
+            0x00B0,0x0105,0x02DB,0x0142,0x00B4,0x013E,0x015B,0x02C7,
+            0x00B8,0x0161,0x015F,0x0165,0x017A,0x02DD,0x017E,0x017C,
+            0x0154,0x00C1,0x00C2,0x0102,0x00C4,0x0139,0x0106,0x00C7,
+            0x010C,0x00C9,0x0118,0x00CB,0x011A,0x00CD,0x00CE,0x010E,
+            0x0110,0x0143,0x0147,0x00D3,0x00D4,0x0150,0x00D6,0x00D7,
+            0x0158,0x016E,0x00DA,0x0170,0x00DC,0x00DD,0x0162,0x00DF,
+            0x0155,0x00E1,0x00E2,0x0103,0x00E4,0x013A,0x0107,0x00E7,
+            0x010D,0x00E9,0x0119,0x00EB,0x011B,0x00ED,0x00EE,0x010F,
+            0x0111,0x0144,0x0148,0x00F3,0x00F4,0x0151,0x00F6,0x00F7,
+            0x0159,0x016F,0x00FA,0x0171,0x00FC,0x00FD,0x0163,0x02D9
+        };
+
+        static constexpr uint8_t iso8859_2_undefined[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t iso8859_2_above_07ff[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+        static constexpr uint8_t iso8859_2_page_index[256] = {
+            1,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t iso8859_2_pages[3][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x80,0x81,0x82,0x83,0x84,0x85,0x86,0x87,0x88,0x89,0x8A,0x8B,0x8C,0x8D,0x8E,0x8F,
+                    0x90,0x91,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9A,0x9B,0x9C,0x9D,0x9E,0x9F,
+                    0xA0,0x00,0x00,0x00,0xA4,0x00,0x00,0xA7,0xA8,0x00,0x00,0x00,0x00,0xAD,0x00,0x00,
+                    0xB0,0x00,0x00,0x00,0xB4,0x00,0x00,0x00,0xB8,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0xC1,0xC2,0x00,0xC4,0x00,0x00,0xC7,0x00,0xC9,0x00,0xCB,0x00,0xCD,0xCE,0x00,
+                    0x00,0x00,0x00,0xD3,0xD4,0x00,0xD6,0xD7,0x00,0x00,0xDA,0x00,0xDC,0xDD,0x00,0xDF,
+                    0x00,0xE1,0xE2,0x00,0xE4,0x00,0x00,0xE7,0x00,0xE9,0x00,0xEB,0x00,0xED,0xEE,0x00,
+                    0x00,0x00,0x00,0xF3,0xF4,0x00,0xF6,0xF7,0x00,0x00,0xFA,0x00,0xFC,0xFD,0x00,0x00
+            },
+            {
+                    0x00,0x00,0xC3,0xE3,0xA1,0xB1,0xC6,0xE6,0x00,0x00,0x00,0x00,0xC8,0xE8,0xCF,0xEF,
+                    0xD0,0xF0,0x00,0x00,0x00,0x00,0x00,0x00,0xCA,0xEA,0xCC,0xEC,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xC5,0xE5,0x00,0x00,0xA5,0xB5,0x00,
+                    0x00,0xA3,0xB3,0xD1,0xF1,0x00,0x00,0xD2,0xF2,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xD5,0xF5,0x00,0x00,0xC0,0xE0,0x00,0x00,0xD8,0xF8,0xA6,0xB6,0x00,0x00,0xAA,0xBA,
+                    0xA9,0xB9,0xDE,0xFE,0xAB,0xBB,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xD9,0xF9,
+                    0xDB,0xFB,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xAC,0xBC,0xAF,0xBF,0xAE,0xBE,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xB7,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA2,0xFF,0x00,0xB2,0x00,0xBD,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            }
+        };
+
+        // ISO-8859-5
+
+        static constexpr uint16_t iso8859_5_to_unicode[128] = {
+            0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+            0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+            0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+            0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+            0x00A0,0x0401,0x0402,0x0403,0x0404,0x0405,0x0406,0x0407,
+            0x0408,0x0409,0x040A,0x040B,0x040C,0x00AD,0x040E,0x040F,
+            0x0410,0x0411,0x0412,0x0413,0x0414,0x0415,0x0416,0x0417,
+            0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,0x041F,
+            0x0420,0x0421,0x0422,0x0423,0x0424,0x0425,0x0426,0x0427,
+            0x0428,0x0429,0x042A,0x042B,0x042C,0x042D,0x042E,0x042F,
+            0x0430,0x0431,0x0432,0x0433,0x0434,0x0435,0x0436,0x0437,
+            0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,0x043F,
+            0x0440,0x0441,0x0442,0x0443,0x0444,0x0445,0x0446,0x0447,
+            0x0448,0x0449,0x044A,0x044B,0x044C,0x044D,0x044E,0x044F,
+            0x2116,0x0451,0x0452,0x0453,0x0454,0x0455,0x0456,0x0457,
+            0x0458,0x0459,0x045A,0x045B,0x045C,0x00A7,0x045E,0x045F
+        };
+
+        static constexpr uint8_t iso8859_5_undefined[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t iso8859_5_above_07ff[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00};
+
+        static constexpr uint8_t iso8859_5_page_index[256] = {
+            1,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t iso8859_5_pages[3][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x80,0x81,0x82,0x83,0x84,0x85,0x86,0x87,0x88,0x89,0x8A,0x8B,0x8C,0x8D,0x8E,0x8F,
+                    0x90,0x91,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9A,0x9B,0x9C,0x9D,0x9E,0x9F,
+                    0xA0,0x00,0x00,0x00,0x00,0x00,0x00,0xFD,0x00,0x00,0x00,0x00,0x00,0xAD,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0xA1,0xA2,0xA3,0xA4,0xA5,0xA6,0xA7,0xA8,0xA9,0xAA,0xAB,0xAC,0x00,0xAE,0xAF,
+                    0xB0,0xB1,0xB2,0xB3,0xB4,0xB5,0xB6,0xB7,0xB8,0xB9,0xBA,0xBB,0xBC,0xBD,0xBE,0xBF,
+                    0xC0,0xC1,0xC2,0xC3,0xC4,0xC5,0xC6,0xC7,0xC8,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,
+                    0xD0,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,0xD7,0xD8,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,
+                    0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEF,
+                    0x00,0xF1,0xF2,0xF3,0xF4,0xF5,0xF6,0xF7,0xF8,0xF9,0xFA,0xFB,0xFC,0x00,0xFE,0xFF,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0xF0,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            }
+        };
+
+        // ISO-8859-15
+
+        static constexpr uint16_t iso8859_15_to_unicode[128] = {
+            0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+            0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+            0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+            0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+            0x00A0,0x00A1,0x00A2,0x00A3,0x20AC,0x00A5,0x0160,0x00A7,
+            0x0161,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+            0x00B0,0x00B1,0x00B2,0x00B3,0x017D,0x00B5,0x00B6,0x00B7,
+            0x017E,0x00B9,0x00BA,0x00BB,0x0152,0x0153,0x0178,0x00BF,
+            0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+            0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+            0x00D0,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+            0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x00DD,0x00DE,0x00DF,
+            0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+            0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+            0x00F0,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+            0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x00FD,0x00FE,0x00FF
+        };
+
+        static constexpr uint8_t iso8859_15_undefined[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t iso8859_15_above_07ff[16] = {0x00,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+        static constexpr uint8_t iso8859_15_page_index[256] = {
+            1,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t iso8859_15_pages[3][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x80,0x81,0x82,0x83,0x84,0x85,0x86,0x87,0x88,0x89,0x8A,0x8B,0x8C,0x8D,0x8E,0x8F,
+                    0x90,0x91,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9A,0x9B,0x9C,0x9D,0x9E,0x9F,
+                    0xA0,0xA1,0xA2,0xA3,0x00,0xA5,0x00,0xA7,0x00,0xA9,0xAA,0xAB,0xAC,0xAD,0xAE,0xAF,
+                    0xB0,0xB1,0xB2,0xB3,0x00,0xB5,0xB6,0xB7,0x00,0xB9,0xBA,0xBB,0x00,0x00,0x00,0xBF,
+                    0xC0,0xC1,0xC2,0xC3,0xC4,0xC5,0xC6,0xC7,0xC8,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,
+                    0xD0,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,0xD7,0xD8,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,
+                    0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEF,
+                    0xF0,0xF1,0xF2,0xF3,0xF4,0xF5,0xF6,0xF7,0xF8,0xF9,0xFA,0xFB,0xFC,0xFD,0xFE,0xFF
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0xBC,0xBD,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xA6,0xA8,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xBE,0x00,0x00,0x00,0x00,0xB4,0xB8,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA4,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            }
+        };
+
+        // KOI8-R
+
+        static constexpr uint16_t koi8_r_to_unicode[128] = {
+            0x2500,0x2502,0x250C,0x2510,0x2514,0x2518,0x251C,0x2524,
+            0x252C,0x2534,0x253C,0x2580,0x2584,0x2588,0x258C,0x2590,
+            0x2591,0x2592,0x2593,0x2320,0x25A0,0x2219,0x221A,0x2248,
+            0x2264,0x2265,0x00A0,0x2321,0x00B0,0x00B2,0x00B7,0x00F7,
+            0x2550,0x2551,0x2552,0x0451,0x2553,0x2554,0x2555,0x2556,
+            0x2557,0x2558,0x2559,0x255A,0x255B,0x255C,0x255D,0x255E,
+            0x255F,0x2560,0x2561,0x0401,0x2562,0x2563,0x2564,0x2565,
+            0x2566,0x2567,0x2568,0x2569,0x256A,0x256B,0x256C,0x00A9,
+            0x044E,0x0430,0x0431,0x0446,0x0434,0x0435,0x0444,0x0433,
+            0x0445,0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,
+            0x043F,0x044F,0x0440,0x0441,0x0442,0x0443,0x0436,0x0432,
+            0x044C,0x044B,0x0437,0x0448,0x044D,0x0449,0x0447,0x044A,
+            0x042E,0x0410,0x0411,0x0426,0x0414,0x0415,0x0424,0x0413,
+            0x0425,0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,
+            0x041F,0x042F,0x0420,0x0421,0x0422,0x0423,0x0416,0x0412,
+            0x042C,0x042B,0x0417,0x0428,0x042D,0x0429,0x0427,0x042A
+        };
+
+        static constexpr uint8_t koi8_r_undefined[16] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+        static constexpr uint8_t koi8_r_above_07ff[16] = {0xFF,0xFF,0xFF,0x0B,0xF7,0xFF,0xF7,0x7F,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+        static constexpr uint8_t koi8_r_page_index[256] = {
+            1,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,3,4,0,5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+            0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+        };
+
+        static constexpr uint8_t koi8_r_pages[5][256] = {
+            {
+                    0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+                    0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+                    0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+                    0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+                    0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+                    0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x5C,0x5D,0x5E,0x5F,
+                    0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+                    0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x7E,0x7F,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x9A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xBF,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x9C,0x00,0x9D,0x00,0x00,0x00,0x00,0x9E,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x9F,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0xB3,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xE1,0xE2,0xF7,0xE7,0xE4,0xE5,0xF6,0xFA,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEF,0xF0,
+                    0xF2,0xF3,0xF4,0xF5,0xE6,0xE8,0xE3,0xFE,0xFB,0xFD,0xFF,0xF9,0xF8,0xFC,0xE0,0xF1,
+                    0xC1,0xC2,0xD7,0xC7,0xC4,0xC5,0xD6,0xDA,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,0xD0,
+                    0xD2,0xD3,0xD4,0xD5,0xC6,0xC8,0xC3,0xDE,0xDB,0xDD,0xDF,0xD9,0xD8,0xDC,0xC0,0xD1,
+                    0x00,0xA3,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x95,0x96,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x97,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x98,0x99,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x93,0x9B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+            },
+            {
+                    0x80,0x00,0x81,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x82,0x00,0x00,0x00,
+                    0x83,0x00,0x00,0x00,0x84,0x00,0x00,0x00,0x85,0x00,0x00,0x00,0x86,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x87,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x88,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x89,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x8A,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0xA0,0xA1,0xA2,0xA4,0xA5,0xA6,0xA7,0xA8,0xA9,0xAA,0xAB,0xAC,0xAD,0xAE,0xAF,0xB0,
+                    0xB1,0xB2,0xB4,0xB5,0xB6,0xB7,0xB8,0xB9,0xBA,0xBB,0xBC,0xBD,0xBE,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x8B,0x00,0x00,0x00,0x8C,0x00,0x00,0x00,0x8D,0x00,0x00,0x00,0x8E,0x00,0x00,0x00,
+                    0x8F,0x90,0x91,0x92,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x94,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
             }
+        };
+    };
+
+    template <class T>
+    constexpr uint16_t codepage_data<T>::windows1251_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1251_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1251_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1251_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1251_pages[4][256];
+    template <class T>
+    constexpr uint16_t codepage_data<T>::windows1252_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1252_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1252_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1252_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::windows1252_pages[5][256];
+    template <class T>
+    constexpr uint16_t codepage_data<T>::iso8859_2_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_2_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_2_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_2_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_2_pages[3][256];
+    template <class T>
+    constexpr uint16_t codepage_data<T>::iso8859_5_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_5_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_5_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_5_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_5_pages[3][256];
+    template <class T>
+    constexpr uint16_t codepage_data<T>::iso8859_15_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_15_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_15_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_15_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::iso8859_15_pages[3][256];
+    template <class T>
+    constexpr uint16_t codepage_data<T>::koi8_r_to_unicode[128];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::koi8_r_undefined[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::koi8_r_above_07ff[16];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::koi8_r_page_index[256];
+    template <class T>
+    constexpr uint8_t codepage_data<T>::koi8_r_pages[5][256];
+
+    template <encoding Encoding>
+    struct codepage_tables;
+
+    template <>
+    struct codepage_tables<encoding::windows1251>
+    {
+        static constexpr bool complete = false;
+
+        static const uint16_t* to_unicode() noexcept
+        {
+            return codepage_data<>::windows1251_to_unicode;
         }
-        return count;
-    }
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::windows1251_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::windows1251_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::windows1251_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::windows1251_pages[page-1][ch & 0xFF];
+        }
+    };
+
+    template <>
+    struct codepage_tables<encoding::windows1252>
+    {
+        static constexpr bool complete = false;
+
+        static const uint16_t* to_unicode() noexcept
+        {
+            return codepage_data<>::windows1252_to_unicode;
+        }
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::windows1252_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::windows1252_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::windows1252_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::windows1252_pages[page-1][ch & 0xFF];
+        }
+    };
 
+    template <>
+    struct codepage_tables<encoding::iso8859_2>
+    {
+        static constexpr bool complete = true;
 
-    // utf32
+        static const uint16_t* to_unicode() noexcept
+        {
+            return codepage_data<>::iso8859_2_to_unicode;
+        }
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::iso8859_2_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::iso8859_2_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::iso8859_2_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::iso8859_2_pages[page-1][ch & 0xFF];
+        }
+    };
 
-    template <typename InputIt>
-    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,size_t>::type 
-    u8_length(InputIt first, InputIt last) noexcept
+    template <>
+    struct codepage_tables<encoding::iso8859_5>
     {
-        std::size_t count = 0;
-        for (InputIt p = first; p < last; ++p)
+        static constexpr bool complete = true;
+
+        static const uint16_t* to_unicode() noexcept
         {
-            uint32_t ch = *p;
-            if (ch < (uint32_t)0x80) {      
-                ++count;
-            } else if (ch < (uint32_t)0x800) {     
-                count += 2;
-            } else if (ch < (uint32_t)0x10000) {   
-                count += 3;
-            } else if (ch <= max_legal_utf32) {  
-                count += 4;
-            } else {                            
-                count += 3;
-            }
+            return codepage_data<>::iso8859_5_to_unicode;
         }
-        return count;
-    }
-
-    // u32_length
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::iso8859_5_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::iso8859_5_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::iso8859_5_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::iso8859_5_pages[page-1][ch & 0xFF];
+        }
+    };
 
-    template <typename InputIt>
-    typename std::enable_if<(is_char8<typename std::iterator_traits<InputIt>::value_type>::value || is_char16<typename std::iterator_traits<InputIt>::value_type>::value),
-                                   std::size_t>::type 
-    u32_length(InputIt first, InputIt last) noexcept
+    template <>
+    struct codepage_tables<encoding::iso8859_15>
     {
-        sequence_generator<InputIt> g(first, last, unicons::conv_flags::strict);
+        static constexpr bool complete = true;
 
-        std::size_t count = 0;
-        while (!g.done())
+        static const uint16_t* to_unicode() noexcept
         {
-            g.next();
-            ++count;
+            return codepage_data<>::iso8859_15_to_unicode;
         }
-        return count;
-    }
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::iso8859_15_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::iso8859_15_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::iso8859_15_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::iso8859_15_pages[page-1][ch & 0xFF];
+        }
+    };
 
-    template <typename InputIt>
-    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value && is_char32<typename std::iterator_traits<InputIt>::value_type>::value,
-                                   std::size_t>::type 
-    u32_length(InputIt first, InputIt last) noexcept
+    template <>
+    struct codepage_tables<encoding::koi8_r>
     {
-        return std::distance(first,last);
-    }
+        static constexpr bool complete = true;
 
-    enum class encoding {u8,u16le,u16be,u32le,u32be,undetected};
+        static const uint16_t* to_unicode() noexcept
+        {
+            return codepage_data<>::koi8_r_to_unicode;
+        }
+        static const uint8_t* undefined() noexcept
+        {
+            return codepage_data<>::koi8_r_undefined;
+        }
+        static const uint8_t* above_07ff() noexcept
+        {
+            return codepage_data<>::koi8_r_above_07ff;
+        }
+        static uint8_t from_unicode(uint32_t ch) noexcept
+        {
+            const uint8_t page = ch < 0x10000 ? codepage_data<>::koi8_r_page_index[ch >> 8] : 0;
+            return page == 0 ? 0 : codepage_data<>::koi8_r_pages[page-1][ch & 0xFF];
+        }
+    };
 
-    template <typename Iterator>
-    struct detect_encoding_result
+#if defined(UNICONS_SSE42)
+    // The lanes of the bytes above 0x7F whose low 7 bits are set in a 128-bit
+    // bitmap
+    inline unsigned match_bytes(__m128i input, __m128i bitmap) noexcept
     {
-        Iterator it;
-        encoding ec;
-    };
+        const __m128i bits = _mm_setr_epi8(1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128);
+        const __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(input, _mm_set1_epi8(7)));
+        const __m128i byte = _mm_shuffle_epi8(bitmap, _mm_and_si128(_mm_srli_epi16(input, 3), _mm_set1_epi8(0x0F)));
+        const __m128i match = _mm_cmpeq_epi8(_mm_and_si128(byte, bit), bit);
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(match, input)));
+    }
+#endif
 
-    template <typename Iterator>
-    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char8<typename std::iterator_traits<Iterator>::value_type>::value,
-                            detect_encoding_result<Iterator>>::type 
-    detect_encoding(Iterator first, Iterator last) noexcept
+    // A single byte codepage to UTF-8, UTF-16 or UTF-32, up to the first 
+    // byte that has no character. Blocks of ASCII are widened 16 bytes at 
+    // a time. Other blocks are widened to 16-bit lanes, the lanes of bytes 
+    // above 0x7F are looked up in the table, and the codepoints are stored,
+    // or encoded as UTF-8 in place if they are all below 0x800.
+    template <encoding Encoding, typename CodeUnit>
+    struct codepage_decode_kernel
     {
-        Iterator it1 = first;
-        if (std::distance(first,last) < 4)
+        typedef uint8_t source_type;
+        typedef CodeUnit target_type;
+        static constexpr std::size_t max_expansion = sizeof(CodeUnit) == 1 ? 3 : 1;
+
+        static std::size_t valid_prefix(const uint8_t* data, std::size_t length) noexcept
         {
-            if (std::distance(first,last) == 3)
+            if (codepage_tables<Encoding>::complete)
             {
-                Iterator it2 = ++first;
-                Iterator it3 = ++first;
-                if (static_cast<uint8_t>(*it1) == 0xEF && static_cast<uint8_t>(*it2) == 0xBB && static_cast<uint8_t>(*it3) == 0xBF)
+                return length;
+            }
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            const __m128i undefined = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codepage_tables<Encoding>::undefined()));
+            for (; length - pos >= 16; pos += 16)
+            {
+                const unsigned mask = match_bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), undefined);
+                if (mask != 0)
                 {
-                    return detect_encoding_result<Iterator>{last,encoding::u8};
+                    return pos + static_cast<std::size_t>(_mm_popcnt_u32((mask & (0u - mask)) - 1));
                 }
             }
-            return detect_encoding_result<Iterator>{it1,encoding::undetected};
+#endif
+            for (; pos < length; ++pos)
+            {
+                if (data[pos] >= 0x80 && codepage_tables<Encoding>::to_unicode()[data[pos] - 0x80] == 0)
+                {
+                    break;
+                }
+            }
+            return pos;
         }
-        else
-        {
-            Iterator it2 = ++first;
-            Iterator it3 = ++first;
-            Iterator it4 = ++first;
 
-            uint32_t bom = static_cast<uint8_t>(*it1) | (static_cast<uint8_t>(*it2) << 8) | (static_cast<uint8_t>(*it3) << 16) | (static_cast<uint8_t>(*it4) << 24);
-            if (bom == 0xFFFE0000)                  
-            { 
-                return detect_encoding_result<Iterator>{it4++,encoding::u32be};
+        static std::size_t output_length(const uint8_t* data, std::size_t length) noexcept
+        {
+            if (sizeof(CodeUnit) != 1)
+            {
+                return length;
             }
-            else if (bom == 0x0000FEFF) 
+            const uint16_t* table = codepage_tables<Encoding>::to_unicode();
+            std::size_t count = length;
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            const __m128i above_07ff = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codepage_tables<Encoding>::above_07ff()));
+            for (; length - pos >= 16; pos += 16)
             {
-                return detect_encoding_result<Iterator>{first,encoding::u32le};
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                count += static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(_mm_movemask_epi8(input))) + 
+                                                  _mm_popcnt_u32(match_bytes(input, above_07ff)));
             }
-            else if ((bom & 0xFFFF) == 0xFFFE)     
+#endif
+            for (; pos < length; ++pos)
             {
-                return detect_encoding_result<Iterator>{it3,encoding::u16be};
+                if (data[pos] >= 0x80)
+                {
+                    count += table[data[pos] - 0x80] < 0x800 ? 1 : 2;
+                }
             }
-            else if ((bom & 0xFFFF) == 0xFEFF)      
+            return count;
+        }
+
+        template <typename T>
+        static T* transcode(const uint8_t* data, std::size_t length, T* target) noexcept
+        {
+            const uint16_t* table = codepage_tables<Encoding>::to_unicode();
+            std::size_t pos = 0;
+#if defined(UNICONS_SSE42)
+            for (; length - pos >= 16; pos += 16)
             {
-                return detect_encoding_result<Iterator>{it3,encoding::u16le};
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(input));
+                if (mask == 0)
+                {
+                    target = store_ascii(input, target);
+                    continue;
+                }
+                uint16_t codepoints[16];
+                store_ascii(input, codepoints);
+                for (; mask != 0; mask &= mask - 1)
+                {
+                    // the number of bits below the lowest set bit
+                    const int i = _mm_popcnt_u32((mask & (0u - mask)) - 1);
+                    codepoints[i] = table[data[pos + i] - 0x80];
+                }
+                target = store_codepoints(codepoints, length - pos >= 24, target);
             }
-            else if ((bom & 0xFFFFFF) == 0xBFBBEF)  
+#endif
+            for (; pos < length; ++pos)
             {
-                return detect_encoding_result<Iterator>{it4,encoding::u8};
+                encode_valid<CodeUnit>(data[pos] < 0x80 ? data[pos] : table[data[pos] - 0x80], target);
             }
-            else
+            return target;
+        }
+
+#if defined(UNICONS_SSE42)
+    private:
+        template <typename T>
+        static typename std::enable_if<sizeof(T) == 1,T*>::type
+        store_codepoints(const uint16_t* codepoints, bool may_overwrite, T* target) noexcept
+        {
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codepoints));
+            const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codepoints + 8));
+            // A block stores 8 bytes at a time, some of which may be past its output.
+            // 8 more bytes give at least 8 more bytes of output to overwrite them.
+            if (may_overwrite && _mm_testz_si128(_mm_or_si128(low, high), _mm_set1_epi16(static_cast<short>(0xF800))))
             {
-                uint32_t pattern = (static_cast<uint8_t>(*it1) ? 1 : 0) | (static_cast<uint8_t>(*it2) ? 2 : 0) | (static_cast<uint8_t>(*it3) ? 4 : 0) | (static_cast<uint8_t>(*it4) ? 8 : 0);
-                switch (pattern) {
-                case 0x08: 
-                    return detect_encoding_result<Iterator>{it1,encoding::u32be};
-                case 0x0A: 
-                    return detect_encoding_result<Iterator>{it1,encoding::u16be};
-                case 0x01: 
-                    return detect_encoding_result<Iterator>{it1,encoding::u32le};
-                case 0x05: 
-                    return detect_encoding_result<Iterator>{it1,encoding::u16le};
-                case 0x0F: 
-                    return detect_encoding_result<Iterator>{it1,encoding::u8};
-                default:
-                    return detect_encoding_result<Iterator>{it1,encoding::undetected};
-                }
+                target = encode_utf8_epi16(low, target);
+                return encode_utf8_epi16(high, target);
             }
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                encode_valid<uint8_t>(codepoints[i], target);
+            }
+            return target;
         }
-    }
 
-    template <typename Iterator>
-    struct skip_bom_result
-    {
-        Iterator it;
-        encoding_errc ec;
+        template <typename T>
+        static typename std::enable_if<sizeof(T) != 1,T*>::type
+        store_codepoints(const uint16_t* codepoints, bool, T* target) noexcept
+        {
+            target = store_bmp(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codepoints)), 8, target);
+            return store_bmp(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codepoints + 8)), 8, target);
+        }
+#endif
     };
 
-    template <typename Iterator>
-    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char8<typename std::iterator_traits<Iterator>::value_type>::value,
-                                   skip_bom_result<Iterator>>::type 
-    skip_bom(Iterator first, Iterator last) noexcept
+    template <encoding Encoding, typename InputIt, typename OutputIt>
+    convert_result<InputIt> decode_codepage(InputIt first, InputIt last, OutputIt& target)
     {
-        auto result = unicons::detect_encoding(first,last);
-        switch (result.ec)
+        typedef typename output_code_unit<OutputIt>::type code_unit;
+
+        const uint16_t* table = codepage_tables<Encoding>::to_unicode();
+        first = transcode_prefix<codepage_decode_kernel<Encoding,code_unit>>(first, last, target);
+        for (; first != last; ++first)
         {
-        case unicons::encoding::u8:
-            return skip_bom_result<Iterator>{result.it,encoding_errc()};
-            break;
-        case unicons::encoding::u16le:
-        case unicons::encoding::u16be:
-            return skip_bom_result<Iterator>{result.it,encoding_errc::expected_u8_found_u16};
-            break;
-        case unicons::encoding::u32le:
-        case unicons::encoding::u32be:
-            return skip_bom_result<Iterator>{result.it,encoding_errc::expected_u8_found_u32};
-            break;
-        default:
-            return skip_bom_result<Iterator>{result.it,encoding_errc()};
-            break;
+            const uint8_t ch = static_cast<uint8_t>(*first);
+            if (ch < 0x80)
+            {
+                *target++ = ch;
+            }
+            else if (table[ch - 0x80] != 0)
+            {
+                encode_valid<code_unit>(table[ch - 0x80], target);
+            }
+            else
+            {
+                return convert_result<InputIt>{first,conv_errc::source_illegal};
+            }
         }
+        return convert_result<InputIt>{first,conv_errc()};
     }
 
-    template <typename Iterator>
-    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char16<typename std::iterator_traits<Iterator>::value_type>::value,
-                                   skip_bom_result<Iterator>>::type 
-    skip_bom(Iterator first, Iterator last) noexcept
+    template <encoding Encoding>
+    struct codepage_encoder
     {
-        if (first == last)
+        template <typename OutputIt>
+        bool operator()(uint32_t ch, OutputIt& target) const
         {
-            return skip_bom_result<Iterator>{first,encoding_errc()};
+            const uint8_t byte = codepage_tables<Encoding>::from_unicode(ch);
+            if (byte == 0 && ch != 0)
+            {
+                return false;
+            }
+            *target++ = byte;
+            return true;
         }
-        uint16_t bom = static_cast<uint16_t>(*first);
-        if (bom == 0xFEFF)                  
+    };
+
+    template <encoding Encoding>
+    struct is_ascii_encoder<codepage_encoder<Encoding>> : std::true_type {};
+
+    // Writes each codepoint as UTF-16 or UTF-32 code units, in the byte order of Tag
+    template <typename Tag>
+    struct byte_order_encoder
+    {
+        typedef typename byte_order_traits<Tag>::code_unit code_unit;
+
+        template <typename OutputIt>
+        bool operator()(uint32_t ch, OutputIt& target) const
         {
-            return skip_bom_result<Iterator>{++first,encoding_errc()};
+            if (sizeof(code_unit) == 2 && ch >= half_base)
+            {
+                ch -= half_base;
+                put((ch >> half_shift) + sur_high_start, target);
+                put((ch & half_mask) + sur_low_start, target);
+            }
+            else
+            {
+                put(ch, target);
+            }
+            return true;
         }
-        else if (bom == 0xFFFE) 
+
+        template <typename OutputIt>
+        static void put(uint32_t unit, OutputIt& target)
         {
-            return skip_bom_result<Iterator>{last,encoding_errc::expected_u16_found_fffe};
+            for (std::size_t i = 0; i < sizeof(code_unit); ++i)
+            {
+                const std::size_t shift = byte_order_traits<Tag>::big_endian ? 8*(sizeof(code_unit) - 1 - i) : 8*i;
+                *target++ = static_cast<uint8_t>(unit >> shift);
+            }
         }
-        else
+    };
+
+} // namespace detail
+
+    // Converts a range of bytes in the given encoding to UTF-8, UTF-16 or UTF-32, 
+    // by the code unit type of the target. A byte that has no character in a 
+    // single byte codepage is conv_errc::source_illegal.
+
+    template <typename InputIt,typename OutputIt>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,typename detail::output_code_unit<OutputIt>::type>::value,
+                            convert_result<InputIt>>::type 
+    convert(encoding source_encoding, InputIt first, InputIt last, OutputIt target)
+    {
+        switch (source_encoding)
         {
-            return skip_bom_result<Iterator>{first,encoding_errc()};
+        case encoding::u8:
+            return convert(first, last, target);
+        case encoding::u16le:
+            return convert(utf16le, first, last, target);
+        case encoding::u16be:
+            return convert(utf16be, first, last, target);
+        case encoding::u32le:
+            return convert(utf32le, first, last, target);
+        case encoding::u32be:
+            return convert(utf32be, first, last, target);
+        case encoding::latin1:
+            return convert(latin1, first, last, target);
+        case encoding::windows1251:
+            return detail::decode_codepage<encoding::windows1251>(first, last, target);
+        case encoding::windows1252:
+            return detail::decode_codepage<encoding::windows1252>(first, last, target);
+        case encoding::iso8859_2:
+            return detail::decode_codepage<encoding::iso8859_2>(first, last, target);
+        case encoding::iso8859_5:
+            return detail::decode_codepage<encoding::iso8859_5>(first, last, target);
+        case encoding::iso8859_15:
+            return detail::decode_codepage<encoding::iso8859_15>(first, last, target);
+        case encoding::koi8_r:
+            return detail::decode_codepage<encoding::koi8_r>(first, last, target);
+        default:
+            return convert_result<InputIt>{first,conv_errc::source_illegal};
         }
     }
 
-    template <typename Iterator>
-    typename std::enable_if<is_character<typename std::iterator_traits<Iterator>::value_type>::value && is_char32<typename std::iterator_traits<Iterator>::value_type>::value,
-                            skip_bom_result<Iterator>>::type 
-    skip_bom(Iterator first, Iterator last) noexcept
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_char8<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value,
+                            convert_result<InputIt>>::type 
+    convert(encoding source_encoding, InputIt first, InputIt last, std::ostreambuf_iterator<CharT,Traits> target)
     {
-        if (first == last)
-        {
-            return skip_bom_result<Iterator>{first,encoding_errc()};
-        }
-        uint32_t bom = static_cast<uint32_t>(*first);
-        if (bom == 0xFEFF0000)                  
-        {
-            return skip_bom_result<Iterator>{++first,encoding_errc()};
-        }
-        else if (bom == 0xFFFE0000) 
-        {
-            return skip_bom_result<Iterator>{last,encoding_errc::expected_u32_found_fffe};
-        }
-        else
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(source_encoding, first, last, detail::ostreambuf_inserter<CharT,Traits>(block));
+        block.flush();
+        return result;
+    }
+
+    // Converts UTF-8, UTF-16 or UTF-32 to a range of bytes in the given encoding.
+    // A codepoint that has no character in the encoding is 
+    // conv_errc::unmappable_character.
+
+    template <typename InputIt,typename OutputIt>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_compatible_output_iterator<OutputIt,uint8_t>::value,
+                            convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, encoding target_encoding, OutputIt target)
+    {
+        switch (target_encoding)
         {
-            return skip_bom_result<Iterator>{first,encoding_errc()};
+        case encoding::u8:
+            return convert(first, last, target);
+        case encoding::u16le:
+            return detail::encode_codepoints(first, last, target, detail::byte_order_encoder<utf16le_t>());
+        case encoding::u16be:
+            return detail::encode_codepoints(first, last, target, detail::byte_order_encoder<utf16be_t>());
+        case encoding::u32le:
+            return detail::encode_codepoints(first, last, target, detail::byte_order_encoder<utf32le_t>());
+        case encoding::u32be:
+            return detail::encode_codepoints(first, last, target, detail::byte_order_encoder<utf32be_t>());
+        case encoding::latin1:
+            return convert(first, last, latin1, target);
+        case encoding::windows1251:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::windows1251>());
+        case encoding::windows1252:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::windows1252>());
+        case encoding::iso8859_2:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::iso8859_2>());
+        case encoding::iso8859_5:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::iso8859_5>());
+        case encoding::iso8859_15:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::iso8859_15>());
+        case encoding::koi8_r:
+            return detail::encode_codepoints(first, last, target, detail::codepage_encoder<encoding::koi8_r>());
+        default:
+            return convert_result<InputIt>{first,conv_errc::source_illegal};
         }
     }
 
+    template <typename InputIt,typename CharT,typename Traits>
+    typename std::enable_if<is_character<typename std::iterator_traits<InputIt>::value_type>::value
+                            && is_character<CharT>::value && sizeof(CharT) == 1,
+                            convert_result<InputIt>>::type 
+    convert(InputIt first, InputIt last, encoding target_encoding, std::ostreambuf_iterator<CharT,Traits> target)
+    {
+        detail::ostreambuf_block<CharT,Traits> block(target);
+        convert_result<InputIt> result = convert(first, last, target_encoding, detail::ostreambuf_inserter<CharT,Traits>(block));
+        block.flush();
+        return result;
+    }
+
+} // namespace UNICONS_SIMD_NAMESPACE
+
 } // namespace unicons
 
 namespace std {
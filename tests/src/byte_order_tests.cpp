@@ -0,0 +1,186 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <string>
+#include <iterator>
+ 
+using namespace unicons;
+
+TEST_CASE("convert utf16 bytes") 
+{
+    std::u16string expected = u"Hello \x65E5\x672C \xD83D\xDE42!"; // U+65E5 U+672C U+1F642
+    std::string utf8 = "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!";
+    std::string be("\0H\0e\0l\0l\0o\0 \x65\xE5\x67\x2C\0 \xD8\x3D\xDE\x42\0!",24);
+    std::string le("H\0e\0l\0l\0o\0 \0\xE5\x65\x2C\x67 \0\x3D\xD8\x42\xDE!\0",24);
+
+    SECTION("big endian")
+    {
+        std::u16string target;
+        auto result = convert(utf16be,be.begin(),be.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == be.end());
+        CHECK(target == expected);
+    }
+
+    SECTION("little endian to utf8")
+    {
+        std::string target;
+        auto result = convert(utf16le,le.begin(),le.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == utf8);
+    }
+
+    SECTION("non-contiguous bytes")
+    {
+        std::deque<uint8_t> d(be.begin(),be.end());
+        std::u32string target;
+        auto result = convert(utf16be,d.begin(),d.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == U"Hello \x65E5\x672C \x1F642!");
+    }
+
+    SECTION("odd number of bytes")
+    {
+        std::string bytes = be + 'x';
+        std::u16string target;
+        auto result = convert(utf16be,bytes.begin(),bytes.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_exhausted);
+        CHECK(result.it == bytes.end() - 1);
+        CHECK(target == expected);
+    }
+
+    SECTION("unpaired high surrogate")
+    {
+        std::string bytes = be.substr(0,20) + std::string("\0!",2);
+        auto result = validate(utf16be,bytes.begin(),bytes.end());
+        CHECK(result.ec == conv_errc::unpaired_high_surrogate);
+        CHECK(result.it == bytes.begin() + 18);
+    }
+
+    SECTION("lengths")
+    {
+        CHECK(u8_length(utf16le,le.begin(),le.end()) == utf8.size());
+        CHECK(u32_length(utf16be,be.begin(),be.end()) == 11);
+    }
+
+    SECTION("surrogate pair across blocks")
+    {
+        std::u16string source;
+        std::string bytes;
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            source += i % 7 == 0 ? u"\xD83D\xDE42" : u"a";
+        }
+        for (char16_t ch : source)
+        {
+            bytes.push_back(static_cast<char>(ch >> 8));
+            bytes.push_back(static_cast<char>(ch & 0xFF));
+        }
+        std::u16string target;
+        auto result = convert(utf16be,bytes.begin(),bytes.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == source);
+        CHECK(validate(utf16be,bytes.begin(),bytes.end()).ec == conv_errc());
+        CHECK(u32_length(utf16be,bytes.begin(),bytes.end()) == u32_length(source.begin(),source.end()));
+    }
+}
+
+TEST_CASE("convert utf32 bytes") 
+{
+    std::u32string expected = U"Hello \x65E5\x1F642";
+    std::string be("\0\0\0H\0\0\0e\0\0\0l\0\0\0l\0\0\0o\0\0\0 \0\0\x65\xE5\0\x01\xF6\x42",32);
+    std::string le("H\0\0\0e\0\0\0l\0\0\0l\0\0\0o\0\0\0 \0\0\0\xE5\x65\0\0\x42\xF6\x01\0",32);
+
+    SECTION("big endian")
+    {
+        std::u32string target;
+        auto result = convert(utf32be,be.begin(),be.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == expected);
+    }
+
+    SECTION("little endian to utf16")
+    {
+        std::vector<uint8_t> bytes(le.begin(),le.end());
+        std::u16string target;
+        auto result = convert(utf32le,bytes.begin(),bytes.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == u"Hello \x65E5\xD83D\xDE42");
+        CHECK(u8_length(utf32le,bytes.begin(),bytes.end()) == 13);
+        CHECK(u32_length(utf32le,bytes.begin(),bytes.end()) == 8);
+    }
+
+    SECTION("illegal value and a part of a code unit")
+    {
+        std::string bytes("a\0\0\0b\0\0\0\0\0\x11\0c\0\0\0d\0\0\0",20);
+        std::u32string source = U"ab\x110000" U"cd";
+        std::u32string expected_target;
+        auto expected = convert(source.begin(),source.end(),std::back_inserter(expected_target),conv_flags::lenient);
+        REQUIRE(expected.ec == conv_errc::source_illegal);
+
+        std::u32string target;
+        auto result = convert(utf32le,bytes.begin(),bytes.end(),std::back_inserter(target),conv_flags::lenient);
+        CHECK(result.ec == expected.ec);
+        CHECK(result.it == bytes.end());
+        CHECK(target == expected_target);
+
+        bytes.push_back('x');
+        target.clear();
+        result = convert(utf32le,bytes.begin(),bytes.end(),std::back_inserter(target),conv_flags::lenient);
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == bytes.end() - 1);
+        CHECK(target == expected_target);
+    }
+
+    SECTION("surrogate value")
+    {
+        std::string bytes = be.substr(0,8) + std::string("\0\0\xD8\0",4);
+        auto result = validate(utf32be,bytes.begin(),bytes.end());
+        CHECK(result.ec == conv_errc::illegal_surrogate_value);
+        CHECK(result.it == bytes.begin() + 8);
+    }
+}
+
+TEST_CASE("convert with flags between pointers of the same type") 
+{
+    SECTION("utf8 to utf8")
+    {
+        char source[] = "Hello \xE6\x97\xA5";
+        char target[16];
+        auto result = convert(source, source + 9, target, conv_flags::strict);
+        CHECK(result.ec == conv_errc());
+        CHECK(std::string(target, 9) == source);
+    }
+
+    SECTION("utf16 to utf16")
+    {
+        char16_t source[] = u"Hello \xD83D\xDE42";
+        char16_t target[16];
+        auto result = convert(source, source + 8, target, conv_flags::strict);
+        CHECK(result.ec == conv_errc());
+        CHECK(std::u16string(target, 8) == source);
+    }
+
+    SECTION("utf32 to utf32")
+    {
+        char32_t source[] = U"Hello \x1F642";
+        char32_t target[16];
+        auto result = convert(source, source + 7, target, conv_flags::strict);
+        CHECK(result.ec == conv_errc());
+        CHECK(std::u32string(target, 7) == source);
+    }
+
+    SECTION("vector iterators")
+    {
+        std::vector<char> source = {'a','b','c'};
+        std::vector<char> target(3);
+        auto result = convert(source.begin(), source.end(), target.begin(), conv_flags::strict);
+        CHECK(result.ec == conv_errc());
+        CHECK(target == source);
+    }
+}
@@ -0,0 +1,267 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits_cjk.hpp>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <string>
+#include <iterator>
+
+using namespace unicons;
+
+TEST_CASE("convert from cjk multibyte encodings")
+{
+    std::string nihongo = "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E"; // 日本語
+    std::string zhongwen = "\xE4\xB8\xAD\xE6\x96\x87"; // 中文
+    std::string katakana_a = "\xEF\xBD\xB1"; // U+FF71
+
+    SECTION("shift_jis")
+    {
+        std::string source = "a \x93\xFA\x96\x7B\x8C\xEA \xB1";
+        std::string target;
+        auto result = convert(cjk_encoding::shift_jis,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(target == "a " + nihongo + " " + katakana_a);
+    }
+
+    SECTION("euc-jp to utf16")
+    {
+        std::string source = "\xC6\xFC\xCB\xDC\xB8\xEC\x8E\xB1\x8F\xB0\xA1";
+        std::u16string target;
+        auto result = convert(cjk_encoding::euc_jp,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == u"\x65E5\x672C\x8A9E\xFF71\x4E02");
+    }
+
+    SECTION("gb18030 to utf32")
+    {
+        std::string source = "\xD6\xD0\xCE\xC4\xA2\xE3\x81\x30\x81\x30\x84\x31\x97\x33\x94\x39\xFC\x36";
+        std::u32string target;
+        auto result = convert(cjk_encoding::gb18030,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == U"\x4E2D\x6587\x20AC\x0080\xFF71\x0001F600");
+    }
+
+    SECTION("gbk has no four byte sequences")
+    {
+        std::string source = "\xD6\xD0\xCE\xC4\x81\x30\x81\x30";
+        std::string target;
+        auto result = convert(cjk_encoding::gbk,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == source.begin() + 4);
+        CHECK(target == zhongwen);
+    }
+
+    SECTION("big5 and euc-kr")
+    {
+        std::string big5 = "\xA4\xA4\xA4\xE5";
+        std::string target;
+        convert(cjk_encoding::big5,big5.begin(),big5.end(),std::back_inserter(target));
+        CHECK(target == zhongwen);
+
+        std::string euc_kr = "\xC7\xD1\xB1\xB9\xBE\xEE\x8C\x63";
+        std::u16string target16;
+        auto result = convert(cjk_encoding::euc_kr,euc_kr.begin(),euc_kr.end(),std::back_inserter(target16));
+        CHECK(result.ec == conv_errc());
+        CHECK(target16 == u"\xD55C\xAD6D\xC5B4\xB620");
+    }
+
+    SECTION("illegal and cut off sequences")
+    {
+        std::string source = std::string(40,'a') + "\x93\xFA\x93\x20";
+        std::string target;
+        auto result = convert(cjk_encoding::shift_jis,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == source.begin() + 42);
+        CHECK(target == std::string(40,'a') + "\xE6\x97\xA5");
+
+        std::string cut_off = "\xD6\xD0\x81\x30\x81";
+        target.clear();
+        result = convert(cjk_encoding::gb18030,cut_off.begin(),cut_off.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_exhausted);
+        CHECK(result.it == cut_off.begin() + 2);
+        CHECK(target == "\xE4\xB8\xAD");
+
+        std::string lead = "\xC6";
+        result = convert(cjk_encoding::euc_jp,lead.begin(),lead.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_exhausted);
+        CHECK(result.it == lead.begin());
+
+        std::string not_lead = "\xFF\xA1";
+        result = convert(cjk_encoding::euc_kr,not_lead.begin(),not_lead.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == not_lead.begin());
+    }
+
+    SECTION("non-contiguous bytes")
+    {
+        std::deque<char> source = {'\x93','\xFA','\x96','\x7B','\x8C','\xEA'};
+        std::string target;
+        auto result = convert(cjk_encoding::shift_jis,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == nihongo);
+    }
+}
+
+TEST_CASE("convert to cjk multibyte encodings")
+{
+    SECTION("shift_jis and euc-jp")
+    {
+        std::string source = "a \xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E \xEF\xBD\xB1\xE4\xB8\x82";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),cjk_encoding::euc_jp,std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(target == "a \xC6\xFC\xCB\xDC\xB8\xEC \x8E\xB1\x8F\xB0\xA1");
+
+        target.clear();
+        result = convert(source.begin(),source.end(),cjk_encoding::shift_jis,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::unmappable_character);
+        CHECK(result.it == source.begin() + 15);
+        CHECK(target == "a \x93\xFA\x96\x7B\x8C\xEA \xB1");
+    }
+
+    SECTION("gb18030 from utf16")
+    {
+        std::u16string source = u"\x4E2D\x6587\x20AC\x0080\xFF71\xD83D\xDE00";
+        std::vector<char> target(20);
+        auto result = convert(source.data(),source.data()+source.size(),cjk_encoding::gb18030,target.data());
+        CHECK(result.ec == conv_errc());
+        CHECK(std::string(target.begin(),target.begin()+18) == "\xD6\xD0\xCE\xC4\xA2\xE3\x81\x30\x81\x30\x84\x31\x97\x33\x94\x39\xFC\x36");
+    }
+
+    SECTION("unmappable character")
+    {
+        std::u32string source = U"\x4E2D\x0001F600";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),cjk_encoding::gbk,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::unmappable_character);
+        CHECK(result.it == source.begin() + 1);
+        CHECK(target == "\xD6\xD0");
+    }
+
+    SECTION("preferred sequence")
+    {
+        std::string source = "\xE5\x8D\x81"; // U+5341, also at 0xA2CC
+        std::string target;
+        convert(source.begin(),source.end(),cjk_encoding::big5,std::back_inserter(target));
+        CHECK(target == "\xA4\x51");
+    }
+
+    SECTION("mixed text")
+    {
+        // Words of ASCII with a few ideographs or kana every few words
+        const std::u32string words = U"\x65E5\x672C\x8A9E\x3042\x4E2D\x6587";
+        std::u32string text;
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            for (std::size_t j = 0; j < 1 + i % 9; ++j)
+            {
+                text.push_back(static_cast<char32_t>('a' + (i + j) % 26));
+            }
+            text.push_back(U' ');
+            if (i % 3 == 0)
+            {
+                text.append(words, i % 4, 1 + i % 3);
+            }
+        }
+        std::string utf8;
+        convert(text.begin(),text.end(),std::back_inserter(utf8));
+        std::u16string utf16;
+        convert(text.begin(),text.end(),std::back_inserter(utf16));
+
+        const cjk_encoding encodings[] = {cjk_encoding::shift_jis,cjk_encoding::euc_jp,cjk_encoding::gb18030,cjk_encoding::big5,cjk_encoding::euc_kr};
+        for (cjk_encoding e : encodings)
+        {
+            std::string expected;
+            for (char32_t ch : text)
+            {
+                std::u32string one(1,ch);
+                convert(one.begin(),one.end(),e,std::back_inserter(expected));
+            }
+
+            std::string from_utf8;
+            auto result8 = convert(utf8.begin(),utf8.end(),e,std::back_inserter(from_utf8));
+            CHECK(result8.ec == conv_errc());
+            CHECK(result8.it == utf8.end());
+            CHECK(from_utf8 == expected);
+
+            std::vector<char> from_utf16(expected.size());
+            auto result16 = convert(utf16.data(),utf16.data()+utf16.size(),e,from_utf16.data());
+            CHECK(result16.ec == conv_errc());
+            CHECK(std::string(from_utf16.begin(),from_utf16.end()) == expected);
+
+            std::string from_utf32;
+            convert(text.begin(),text.end(),e,std::back_inserter(from_utf32));
+            CHECK(from_utf32 == expected);
+
+            std::deque<char> deque8(utf8.begin(),utf8.end());
+            std::string from_deque;
+            convert(deque8.begin(),deque8.end(),e,std::back_inserter(from_deque));
+            CHECK(from_deque == expected);
+        }
+
+        // An unmappable character after several runs of ASCII
+        std::string source = utf8.substr(0,1000) + "\xF0\x9F\x98\x80" "abc"; // U+1F600
+        std::string target;
+        auto result = convert(source.begin(),source.end(),cjk_encoding::shift_jis,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::unmappable_character);
+        CHECK(result.it == source.begin() + 1000);
+    }
+
+    SECTION("ascii inside an illegal sequence")
+    {
+        std::string source = "ab\xE2\x28\xA1zz";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),cjk_encoding::shift_jis,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::expected_continuation_byte);
+        CHECK(result.it == source.begin() + 2);
+        CHECK(target == "ab");
+    }
+
+    SECTION("round trip")
+    {
+        const cjk_encoding encodings[] = {cjk_encoding::shift_jis,cjk_encoding::euc_jp,cjk_encoding::gbk,
+                                      cjk_encoding::gb18030,cjk_encoding::big5,cjk_encoding::euc_kr};
+        for (cjk_encoding e : encodings)
+        {
+            // ASCII, hiragana, Greek and ideographs that every encoding has
+            const std::u32string ideographs = U"\x65E5\x672C\x4E2D\x6587\x4E00\x4E8C\x4E09\x4EBA\x5927\x8A9E\x5B57\x5B78\x570B";
+            std::u32string text;
+            for (std::size_t i = 0; i < 2000; ++i)
+            {
+                switch (i % 4)
+                {
+                    case 0: text.push_back(static_cast<char32_t>('a' + i % 26)); break;
+                    case 1: text.push_back(static_cast<char32_t>(0x3041 + i % 83)); break;
+                    case 2: text.push_back(static_cast<char32_t>(0x0391 + i % 17)); break;
+                    default: text.push_back(ideographs[i % ideographs.size()]); break;
+                }
+            }
+            std::string source;
+            auto encoded = convert(text.begin(),text.end(),e,std::back_inserter(source));
+            REQUIRE(encoded.ec == conv_errc());
+
+            std::string utf8;
+            auto result = convert(e,source.begin(),source.end(),std::back_inserter(utf8));
+            REQUIRE(result.ec == conv_errc());
+            std::u16string utf16;
+            convert(e,source.begin(),source.end(),std::back_inserter(utf16));
+            std::u32string utf32;
+            convert(e,source.begin(),source.end(),std::back_inserter(utf32));
+            CHECK(utf32 == text);
+
+            std::string from_utf8;
+            auto result8 = convert(utf8.begin(),utf8.end(),e,std::back_inserter(from_utf8));
+            CHECK(result8.ec == conv_errc());
+            CHECK(from_utf8 == source);
+
+            std::string from_utf16;
+            convert(utf16.begin(),utf16.end(),e,std::back_inserter(from_utf16));
+            CHECK(from_utf16 == source);
+        }
+    }
+}
@@ -0,0 +1,247 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <string>
+#include <iterator>
+ 
+using namespace unicons;
+
+TEST_CASE("convert from single byte codepages") 
+{
+    std::string privet = "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82"; // Привет
+    std::string euro = "\xE2\x82\xAC";
+
+    SECTION("windows-1251")
+    {
+        std::string source = "\xCF\xF0\xE8\xE2\xE5\xF2 \x88";
+        std::string target;
+        auto result = convert(encoding::windows1251,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(target == privet + " " + euro);
+    }
+
+    SECTION("koi8-r to utf16")
+    {
+        std::string source = "\xF0\xD2\xC9\xD7\xC5\xD4";
+        std::u16string target;
+        auto result = convert(encoding::koi8_r,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == u"\x041F\x0440\x0438\x0432\x0435\x0442");
+    }
+
+    SECTION("iso-8859-2, iso-8859-5 and iso-8859-15 to utf32")
+    {
+        std::string source = "Za\xBF\xF3\xB3\xE6";
+        std::u32string target;
+        convert(encoding::iso8859_2,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(target == U"Za\x017C\x00F3\x0142\x0107");
+
+        std::string cyrillic = "\xBF\xE0\xD8\xD2\xD5\xE2";
+        target.clear();
+        convert(encoding::iso8859_5,cyrillic.begin(),cyrillic.end(),std::back_inserter(target));
+        CHECK(target == U"\x041F\x0440\x0438\x0432\x0435\x0442");
+
+        std::string latin9 = "\xA4";
+        target.clear();
+        convert(encoding::iso8859_15,latin9.begin(),latin9.end(),std::back_inserter(target));
+        CHECK(target == U"\x20AC");
+    }
+
+    SECTION("byte with no character")
+    {
+        std::string source(40,'a');
+        source += "\x80\x81";
+        std::string target;
+        auto result = convert(encoding::windows1252,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == source.begin() + 41);
+        CHECK(target == std::string(40,'a') + euro);
+    }
+
+    SECTION("non-contiguous bytes")
+    {
+        std::deque<char> source = {'\xCF','\xF0','\xE8','\xE2','\xE5','\xF2'};
+        std::string target;
+        auto result = convert(encoding::windows1251,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == privet);
+    }
+
+    SECTION("utf encodings")
+    {
+        std::string source("\0H\0i",4);
+        std::string target;
+        auto result = convert(encoding::u16be,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == "Hi");
+
+        target.clear();
+        result = convert(encoding::undetected,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == source.begin());
+    }
+}
+
+TEST_CASE("convert to single byte codepages") 
+{
+    SECTION("windows-1251")
+    {
+        std::string source = "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xE2\x82\xAC";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),encoding::windows1251,std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(target == "\xCF\xF0\xE8\xE2\xE5\xF2 \x88");
+    }
+
+    SECTION("iso-8859-2 from utf16")
+    {
+        std::u16string source = u"Za\x017C\x00F3\x0142\x0107";
+        std::vector<char> target(source.size());
+        auto result = convert(source.data(),source.data()+source.size(),encoding::iso8859_2,target.data());
+        CHECK(result.ec == conv_errc());
+        CHECK(std::string(target.begin(),target.end()) == "Za\xBF\xF3\xB3\xE6");
+    }
+
+    SECTION("unmappable character")
+    {
+        std::u32string source = U"abc\x041F\x0107";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),encoding::koi8_r,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::unmappable_character);
+        CHECK(result.it == source.begin() + 4);
+        CHECK(target == "abc\xF0");
+
+        std::string utf8 = std::string(300,'a') + "\xC5\xB8\xE2\x82\xAC"; // U+0178 U+20AC
+        target.clear();
+        auto result8 = convert(utf8.begin(),utf8.end(),encoding::iso8859_2,std::back_inserter(target));
+        CHECK(result8.ec == conv_errc::unmappable_character);
+        CHECK(result8.it == utf8.begin() + 300);
+        CHECK(target == std::string(300,'a'));
+    }
+
+    SECTION("mixed text")
+    {
+        // Words of ASCII with an accented letter every few words
+        const std::u32string accents = U"\x00E9\x00FC\x00F1\x20AC\x00E0";
+        std::u32string text;
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            for (std::size_t j = 0; j < 1 + i % 9; ++j)
+            {
+                text.push_back(static_cast<char32_t>('a' + (i + j) % 26));
+            }
+            text.push_back(i % 4 == 0 ? accents[i % accents.size()] : U' ');
+        }
+        std::string utf8;
+        convert(text.begin(),text.end(),std::back_inserter(utf8));
+        std::u16string utf16;
+        convert(text.begin(),text.end(),std::back_inserter(utf16));
+
+        const encoding encodings[] = {encoding::windows1252,encoding::iso8859_15};
+        for (encoding e : encodings)
+        {
+            std::string expected;
+            for (char32_t ch : text)
+            {
+                std::u32string one(1,ch);
+                convert(one.begin(),one.end(),e,std::back_inserter(expected));
+            }
+
+            std::string from_utf8;
+            auto result8 = convert(utf8.begin(),utf8.end(),e,std::back_inserter(from_utf8));
+            CHECK(result8.ec == conv_errc());
+            CHECK(result8.it == utf8.end());
+            CHECK(from_utf8 == expected);
+
+            std::vector<char> from_utf16(expected.size());
+            auto result16 = convert(utf16.data(),utf16.data()+utf16.size(),e,from_utf16.data());
+            CHECK(result16.ec == conv_errc());
+            CHECK(std::string(from_utf16.begin(),from_utf16.end()) == expected);
+
+            std::string from_utf32;
+            convert(text.begin(),text.end(),e,std::back_inserter(from_utf32));
+            CHECK(from_utf32 == expected);
+
+            std::deque<char> deque8(utf8.begin(),utf8.end());
+            std::string from_deque;
+            convert(deque8.begin(),deque8.end(),e,std::back_inserter(from_deque));
+            CHECK(from_deque == expected);
+        }
+
+        // Errors after several runs of ASCII stop where convert to UTF-32 stops
+        const std::string errors[] = {"\xC5\x87", "\xC3", "\xE2\x82", "\xFF"};
+        for (const std::string& error : errors)
+        {
+            std::string source = utf8.substr(0,1000) + error + "abc";
+            std::u32string utf32;
+            auto expected = convert(source.begin(),source.end(),std::back_inserter(utf32));
+            std::string target;
+            auto result = convert(source.begin(),source.end(),encoding::windows1252,std::back_inserter(target));
+            CHECK(result.ec == (expected.ec == conv_errc() ? conv_errc::unmappable_character : expected.ec));
+            CHECK(result.it == source.begin() + 1000);
+        }
+    }
+
+    SECTION("ascii inside an illegal sequence")
+    {
+        const std::string sources[] = {"ab\xE2\x28\xA1zz", "ab\xF0\x9F\x28zz", "\xC3\xA9\xE2\x28\xA1", "ab\xC3("};
+        for (const std::string& source : sources)
+        {
+            auto expected = validate(source.begin(),source.end());
+            std::string target;
+            auto result = convert(source.begin(),source.end(),encoding::windows1252,std::back_inserter(target));
+            CHECK(result.ec == expected.ec);
+            CHECK(result.it == expected.it);
+        }
+    }
+
+    SECTION("utf encodings")
+    {
+        std::u16string source = u"Hi\xD83D\xDE42";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),encoding::u16le,std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == std::string("H\0i\0\x3D\xD8\x42\xDE",8));
+
+        target.clear();
+        result = convert(source.begin(),source.end(),encoding::u32be,std::back_inserter(target));
+        CHECK(target == std::string("\0\0\0H\0\0\0i\0\x01\xF6\x42",12));
+    }
+
+    SECTION("round trip")
+    {
+        const encoding encodings[] = {encoding::latin1,encoding::windows1251,encoding::windows1252,
+                                      encoding::iso8859_2,encoding::iso8859_5,encoding::iso8859_15,encoding::koi8_r};
+        for (encoding e : encodings)
+        {
+            std::string source;
+            for (int i = 0; i < 2000; ++i)
+            {
+                const int ch = i % 3 == 0 ? 0xA0 + i % 96 : 'a' + i % 26;
+                source.push_back(static_cast<char>(ch));
+            }
+            std::string utf8;
+            auto result = convert(e,source.begin(),source.end(),std::back_inserter(utf8));
+            REQUIRE(result.ec == conv_errc());
+            std::u16string utf16;
+            convert(e,source.begin(),source.end(),std::back_inserter(utf16));
+
+            std::string from_utf8;
+            auto result8 = convert(utf8.begin(),utf8.end(),e,std::back_inserter(from_utf8));
+            CHECK(result8.ec == conv_errc());
+            CHECK(from_utf8 == source);
+
+            std::string from_utf16;
+            convert(utf16.begin(),utf16.end(),e,std::back_inserter(from_utf16));
+            CHECK(from_utf16 == source);
+        }
+    }
+}
+
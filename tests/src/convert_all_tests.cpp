@@ -0,0 +1,91 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <string>
+#include <iterator>
+
+using namespace unicons;
+
+TEST_CASE("convert_all utf8")
+{
+    SECTION("maximal subparts")
+    {
+        // Unicode Table 3-8
+        std::string source = "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64";
+        std::u32string target;
+        auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.replacements == 6);
+        CHECK(target == U"a\xFFFD\xFFFD\xFFFD" U"b\xFFFD" U"c\xFFFD\xFFFD" U"d");
+    }
+
+    SECTION("surrogates and overlong sequences")
+    {
+        std::string source = "a\xED\xA0\x80" "b\xC0\xAF" "c";
+        std::u16string target;
+        auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.replacements == 5);
+        CHECK(target == u"a\xFFFD\xFFFD\xFFFD" u"b\xFFFD\xFFFD" u"c");
+    }
+
+    SECTION("truncated sequence at end")
+    {
+        std::string source = "Hello \xE6\x97";
+        std::string target;
+        auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.replacements == 1);
+        CHECK(target == "Hello \xEF\xBF\xBD");
+    }
+
+    SECTION("valid")
+    {
+        std::string source = "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!";
+        std::string target;
+        auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.replacements == 0);
+        CHECK(target == source);
+    }
+
+    SECTION("long range to a pointer")
+    {
+        std::string source;
+        std::u16string expected;
+        for (std::size_t i = 0; i < 200; ++i)
+        {
+            source += "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!\xFF";
+            expected += u"Hello \x65E5\x672C \xD83D\xDE42!\xFFFD";
+        }
+        std::vector<char16_t> target(expected.size());
+        auto result = convert_all(source.data(),source.data() + source.size(),target.data());
+        CHECK(result.replacements == 200);
+        CHECK(result.out == target.data() + target.size());
+        CHECK(std::u16string(target.begin(),target.end()) == expected);
+
+        std::deque<char> d(source.begin(),source.end());
+        std::u16string target2;
+        CHECK(convert_all(d.begin(),d.end(),std::back_inserter(target2)).replacements == 200);
+        CHECK(target2 == expected);
+    }
+}
+
+TEST_CASE("convert_all utf16")
+{
+    std::u16string source = u"a\xD800" u"b\xDC00\xD83D\xDE42\xD800";
+    std::string target;
+    auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+    CHECK(result.replacements == 3);
+    CHECK(target == "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xf0\x9f\x99\x82\xEF\xBF\xBD");
+}
+
+TEST_CASE("convert_all utf32")
+{
+    std::u32string source = U"a\xD800" U"b\x110000" U"c";
+    std::u16string target;
+    auto result = convert_all(source.begin(),source.end(),std::back_inserter(target));
+    CHECK(result.replacements == 2);
+    CHECK(target == u"a\xFFFD" u"b\xFFFD" u"c");
+}
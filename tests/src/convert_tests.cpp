@@ -3,10 +3,14 @@
 
 #include <catch/catch.hpp>
 #include <unicode_traits.hpp>
+#include <algorithm>
 #include <iostream>
 #include <cstdint>
 #include <iterator>
 #include <type_traits>
+#include <vector>
+#include <deque>
+#include <sstream>
 
 using namespace unicons;
 
@@ -392,3 +396,615 @@ TEST_CASE("append codepoint to string")
 TEST_CASE("surrogate pair") 
 {
 }
+
+TEST_CASE("convert ascii runs") 
+{
+    // A non-ASCII character at each offset within and across 64-bit words
+    for (std::size_t pos = 0; pos < 20; ++pos)
+    {
+        std::string source8(24, 'a');
+        source8.replace(pos, 1, "\xE6\x97\xA5"); // U+65E5
+        std::u16string source16(24, u'a');
+        source16[pos] = 0x65E5;
+        std::u32string source32(24, U'a');
+        source32[pos] = 0x65E5;
+
+        std::string target8;
+        auto result8 = convert(source16.begin(),source16.end(),std::back_inserter(target8));
+        REQUIRE(result8.ec == conv_errc());
+        CHECK(target8 == source8);
+        target8.clear();
+        auto result8b = convert(source32.begin(),source32.end(),std::back_inserter(target8));
+        REQUIRE(result8b.ec == conv_errc());
+        CHECK(target8 == source8);
+
+        std::u16string target16;
+        auto result16 = convert(source8.begin(),source8.end(),std::back_inserter(target16));
+        REQUIRE(result16.ec == conv_errc());
+        CHECK(target16 == source16);
+
+        std::u32string target32;
+        auto result32 = convert(source8.begin(),source8.end(),std::back_inserter(target32));
+        REQUIRE(result32.ec == conv_errc());
+        CHECK(target32 == source32);
+
+        CHECK(u8_length(source16.begin(),source16.end()) == source8.size());
+        CHECK(u8_length(source32.begin(),source32.end()) == source8.size());
+        CHECK(u32_length(source8.begin(),source8.end()) == 24);
+        CHECK(u32_length(source16.begin(),source16.end()) == 24);
+    }
+
+    SECTION("error after ascii run")
+    {
+        std::string source = "Hello world, hello world \xE6\x41";
+        std::u16string target;
+        auto result = convert(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::source_exhausted);
+        CHECK(result.it == source.end() - 2);
+        CHECK(target == u"Hello world, hello world ");
+    }
+}
+
+// A long range with runs of characters of each UTF-8 length, for the 
+// vectorized paths, and then a mix of them
+static std::u32string long_codepoints()
+{
+    const char32_t cps[] = {U'a', U' ', 0x416, 0x7FF, 0x800, 0x65E5, 0xFFFD, 0x1F642, 0x10000, 0x10FFFF};
+    const std::size_t runs[][2] = {{0,2}, {2,2}, {4,3}, {7,3}};
+    std::u32string codepoints;
+    for (std::size_t i = 0; i < 400; ++i)
+    {
+        std::size_t run = i / 50;
+        codepoints.push_back(run < 4 ? cps[runs[run][0] + i % runs[run][1]] : cps[(i * 7 + i / 3) % 10]);
+    }
+    return codepoints;
+}
+
+// Puts an error at pos, by overwriting a byte, inserting an unpaired 
+// surrogate, or overwriting a value with a surrogate or out of range value
+
+static std::string with_error(std::string source, std::size_t pos)
+{
+    source[pos] = (pos % 2 == 0) ? '\xC0' : '\xFF';
+    return source;
+}
+
+static std::u16string with_error(std::u16string source, std::size_t pos)
+{
+    source.insert(source.begin()+pos, (pos % 2 == 0) ? char16_t(0xD800) : char16_t(0xDC00));
+    return source;
+}
+
+static std::u32string with_error(std::u32string source, std::size_t pos)
+{
+    source[pos] = (pos % 2 == 0) ? 0xD800 : 0x110000;
+    return source;
+}
+
+// Converts a long source to a pointer and a back inserter, and with an 
+// error every few code units, checks that the contiguous range stops where 
+// a non-contiguous copy does
+template <typename SourceString, typename TargetString>
+void check_long_convert()
+{
+    typedef typename SourceString::value_type source_unit;
+    typedef typename TargetString::value_type target_unit;
+
+    const std::u32string codepoints = long_codepoints();
+    SourceString source;
+    convert(codepoints.begin(),codepoints.end(),std::back_inserter(source));
+    TargetString expected;
+    convert(codepoints.begin(),codepoints.end(),std::back_inserter(expected));
+
+    std::vector<target_unit> target(expected.size());
+    auto result = convert(source.data(),source.data()+source.size(),target.data());
+    REQUIRE(result.ec == conv_errc());
+    CHECK(result.it == source.data()+source.size());
+    CHECK(TargetString(target.begin(),target.end()) == expected);
+
+    TargetString target2;
+    auto result2 = convert(source.begin(),source.end(),std::back_inserter(target2));
+    REQUIRE(result2.ec == conv_errc());
+    CHECK(target2 == expected);
+
+    for (std::size_t pos = 0; pos < source.size(); pos += 23)
+    {
+        SourceString bad = with_error(source, pos);
+        std::vector<target_unit> target3(expected.size() + 4);
+        auto result3 = convert(bad.data(),bad.data()+bad.size(),target3.data());
+
+        std::deque<source_unit> bad2(bad.begin(),bad.end());
+        TargetString target4;
+        auto result4 = convert(bad2.begin(),bad2.end(),std::back_inserter(target4));
+        CHECK(result4.ec != conv_errc());
+        CHECK(result3.ec == result4.ec);
+        CHECK(result3.it - bad.data() == result4.it - bad2.begin());
+        CHECK(TargetString(target3.data(),target4.size()) == target4);
+    }
+}
+
+TEST_CASE("convert long range") 
+{
+    SECTION("utf8 to utf16")
+    {
+        check_long_convert<std::string,std::u16string>();
+    }
+    SECTION("utf8 to utf32")
+    {
+        check_long_convert<std::string,std::u32string>();
+    }
+    SECTION("utf16 to utf8")
+    {
+        check_long_convert<std::u16string,std::string>();
+    }
+    SECTION("utf16 to utf32")
+    {
+        check_long_convert<std::u16string,std::u32string>();
+    }
+    SECTION("utf32 to utf8")
+    {
+        check_long_convert<std::u32string,std::string>();
+    }
+    SECTION("utf32 to utf16")
+    {
+        check_long_convert<std::u32string,std::u16string>();
+    }
+}
+
+TEST_CASE("convert to bounded range") 
+{
+    std::string source = "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!"; // U+65E5 U+672C U+1F642
+    std::u16string expected = u"Hello \x65E5\x672C \xD83D\xDE42!";
+
+    SECTION("target large enough")
+    {
+        char16_t target[16];
+        auto result = convert(source.begin(),source.end(),target,target + 16);
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(std::u16string(target,result.out) == expected);
+    }
+
+    SECTION("target exhausted before a surrogate pair")
+    {
+        char16_t target[10];
+        auto result = convert(source.begin(),source.end(),target,target + 10);
+        CHECK(result.ec == conv_errc::target_exhausted);
+        CHECK(result.it == source.begin() + 13);
+        CHECK(std::u16string(target,result.out) == u"Hello \x65E5\x672C ");
+    }
+
+    SECTION("resume in small buffers")
+    {
+        for (std::size_t size = 2; size <= 4; ++size)
+        {
+            std::u16string target;
+            auto it = source.begin();
+            for (;;)
+            {
+                char16_t buffer[4];
+                auto result = convert(it,source.end(),buffer,buffer + size);
+                target.append(buffer,result.out);
+                it = result.it;
+                if (result.ec != conv_errc::target_exhausted)
+                {
+                    CHECK(result.ec == conv_errc());
+                    break;
+                }
+            }
+            CHECK(it == source.end());
+            CHECK(target == expected);
+        }
+    }
+
+    SECTION("utf16 to utf8 does not split a sequence")
+    {
+        char target[8];
+        auto result = convert(expected.begin(),expected.end(),target,target + 8);
+        CHECK(result.ec == conv_errc::target_exhausted);
+        CHECK(result.it == expected.begin() + 6);
+        CHECK(std::string(target,result.out) == "Hello ");
+    }
+
+    SECTION("illegal sequence")
+    {
+        std::string bad = "Hello \xE6\x41 world";
+        char32_t target[32];
+        auto result = convert(bad.begin(),bad.end(),target,target + 32);
+        CHECK(result.ec == conv_errc::expected_continuation_byte);
+        CHECK(result.it == bad.begin() + 6);
+        CHECK(std::u32string(target,result.out) == U"Hello ");
+    }
+
+    SECTION("out of range utf32 value")
+    {
+        std::u32string bad = U"ab";
+        bad.push_back(static_cast<char32_t>(0x110000));
+        bad += U"cdefghij";
+
+        char16_t small[4];
+        auto result = convert(bad.begin(),bad.end(),small,small + 4);
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(result.it == bad.begin() + 2);
+        CHECK(std::u16string(small,result.out) == u"ab");
+
+        char target[32];
+        auto result8 = convert(bad.begin(),bad.end(),target,target + 32);
+        CHECK(result8.ec == conv_errc::source_illegal);
+        CHECK(result8.it == bad.begin() + 2);
+        CHECK(std::string(target,result8.out) == "ab");
+    }
+
+    SECTION("out of range utf32 value resumed in lenient mode")
+    {
+        std::u32string bad = U"ab";
+        bad.push_back(static_cast<char32_t>(0x110000));
+        bad += U"cdefghij";
+
+        char target[64];
+        auto whole = convert(bad.begin(),bad.end(),target,target + 64,conv_flags::lenient);
+        CHECK(whole.ec == conv_errc::source_illegal);
+        CHECK(whole.it == bad.begin() + 3);
+        CHECK(std::string(target,whole.out) == "ab\xEF\xBF\xBD");
+
+        std::string resumed;
+        std::vector<conv_errc> errors;
+        auto it = bad.begin();
+        while (it != bad.end())
+        {
+            char buffer[4];
+            auto result = convert(it,bad.end(),buffer,buffer + 4,conv_flags::lenient);
+            resumed.append(buffer,result.out);
+            it = result.it;
+            if (result.ec != conv_errc::target_exhausted)
+            {
+                errors.push_back(result.ec);
+            }
+        }
+        CHECK(resumed == "ab\xEF\xBF\xBD" "cdefghij");
+        CHECK(std::count(errors.begin(),errors.end(),conv_errc::source_illegal) == 1);
+    }
+
+    SECTION("long range")
+    {
+        std::string long_source;
+        for (std::size_t i = 0; i < 50; ++i)
+        {
+            long_source += source;
+        }
+        std::u16string long_expected;
+        convert(long_source.begin(),long_source.end(),std::back_inserter(long_expected));
+
+        std::vector<char16_t> target(long_expected.size());
+        auto result = convert(long_source.data(),long_source.data() + long_source.size(),target.data(),target.data() + target.size());
+        CHECK(result.ec == conv_errc());
+        CHECK(result.out == target.data() + target.size());
+        CHECK(std::u16string(target.begin(),target.end()) == long_expected);
+
+        auto result2 = convert(long_source.data(),long_source.data() + long_source.size(),target.data(),target.data() + 100);
+        CHECK(result2.ec == conv_errc::target_exhausted);
+        CHECK(result2.out - target.data() >= 99);
+        CHECK(std::u16string(target.data(),result2.out) == long_expected.substr(0,result2.out - target.data()));
+    }
+}
+
+TEST_CASE("convert_to") 
+{
+    std::string source = "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!"; // U+65E5 U+672C U+1F642
+    std::u16string expected16 = u"Hello \x65E5\x672C \xD83D\xDE42!";
+    std::u32string expected32 = U"Hello \x65E5\x672C \x1F642!";
+
+    SECTION("utf8 to utf16 and utf32")
+    {
+        CHECK(convert_to<std::u16string>(source) == expected16);
+        CHECK(convert_to<std::u32string>(source.begin(),source.end()) == expected32);
+    }
+
+    SECTION("utf16 and utf32 to utf8")
+    {
+        CHECK(convert_to<std::string>(expected16) == source);
+        CHECK(convert_to<std::string>(expected32) == source);
+        CHECK(convert_to<std::u16string>(expected32) == expected16);
+    }
+
+    SECTION("to a vector")
+    {
+        std::vector<char16_t> target = convert_to<std::vector<char16_t>>(source);
+        CHECK(std::u16string(target.begin(),target.end()) == expected16);
+    }
+
+    SECTION("non-contiguous source")
+    {
+        std::deque<char> d(source.begin(),source.end());
+        CHECK(convert_to<std::u16string>(d) == expected16);
+    }
+
+    SECTION("empty source")
+    {
+        std::string empty;
+        CHECK(convert_to<std::u16string>(empty).empty());
+    }
+
+    SECTION("illegal sequence")
+    {
+        std::string bad = "Hello \xE6\x41 world";
+        std::error_code ec;
+        std::u16string target = convert_to<std::u16string>(bad, ec);
+        CHECK(ec == conv_errc::expected_continuation_byte);
+        CHECK(target.substr(0,6) == u"Hello ");
+
+        CHECK_THROWS_AS(convert_to<std::u16string>(bad), unicode_error);
+    }
+
+    SECTION("long range")
+    {
+        std::string long_source;
+        for (std::size_t i = 0; i < 100; ++i)
+        {
+            long_source += source;
+        }
+        std::u16string long_expected;
+        convert(long_source.begin(),long_source.end(),std::back_inserter(long_expected));
+        std::u16string target = convert_to<std::u16string>(long_source);
+        CHECK(target == long_expected);
+        CHECK(convert_to<std::string>(target) == long_source);
+    }
+}
+
+TEST_CASE("convert appends to back_inserter") 
+{
+    std::string source;
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        source += "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!"; // U+65E5 U+672C U+1F642
+    }
+    std::deque<char> d(source.begin(),source.end());
+    std::u16string expected = u"prefix ";
+    convert(d.begin(),d.end(),std::back_inserter(expected));
+
+    SECTION("string")
+    {
+        std::u16string target = u"prefix ";
+        auto result = convert(source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == expected);
+    }
+
+    SECTION("vector")
+    {
+        std::vector<uint16_t> target = {'p','r','e','f','i','x',' '};
+        auto result = convert(source.data(),source.data() + source.size(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(std::u16string(target.begin(),target.end()) == expected);
+    }
+
+    SECTION("illegal sequence")
+    {
+        std::string bad = source + "\xE6\x41 world";
+        std::u16string target = u"prefix ";
+        auto result = convert(bad.begin(),bad.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc::expected_continuation_byte);
+        CHECK(result.it == bad.begin() + source.size());
+        CHECK(target == expected);
+    }
+}
+
+// Counts the calls that write to it, and keeps what is written, up to a limit
+class counting_streambuf : public std::streambuf
+{
+public:
+    std::string str;
+    std::size_t limit = std::string::npos;
+    std::size_t xsputn_calls = 0;
+    std::size_t overflow_calls = 0;
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        ++xsputn_calls;
+        std::size_t length = (std::min)(static_cast<std::size_t>(n), limit - str.size());
+        str.append(s, length);
+        return static_cast<std::streamsize>(length);
+    }
+
+    int_type overflow(int_type c) override
+    {
+        ++overflow_calls;
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            return traits_type::not_eof(c);
+        }
+        if (str.size() == limit)
+        {
+            return traits_type::eof();
+        }
+        str.push_back(traits_type::to_char_type(c));
+        return c;
+    }
+};
+
+TEST_CASE("convert to ostreambuf_iterator") 
+{
+    std::u16string unit = u"Hello \x65E5\x672C \xD83D\xDE42!"; // U+65E5 U+672C U+1F642
+    std::u16string source;
+    for (std::size_t i = 0; i < 200; ++i)
+    {
+        source += unit;
+    }
+    std::string expected;
+    convert(source.begin(),source.end(),std::back_inserter(expected));
+    std::u16string long_source;
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+        long_source += source;
+    }
+    std::string long_expected;
+    convert(long_source.begin(),long_source.end(),std::back_inserter(long_expected));
+
+    SECTION("utf16 to utf8")
+    {
+        std::ostringstream os;
+        auto result = convert(source.begin(),source.end(),std::ostreambuf_iterator<char>(os));
+        CHECK(result.ec == conv_errc());
+        CHECK(os.str() == expected);
+    }
+
+    SECTION("utf32 to utf8")
+    {
+        std::u32string source32;
+        convert(source.begin(),source.end(),std::back_inserter(source32));
+        std::ostringstream os;
+        auto result = convert(source32.begin(),source32.end(),std::ostreambuf_iterator<char>(os));
+        CHECK(result.ec == conv_errc());
+        CHECK(os.str() == expected);
+    }
+
+    SECTION("illegal sequence")
+    {
+        std::u16string bad = source;
+        bad.insert(bad.begin() + 1000, static_cast<char16_t>(0xD800));
+        std::ostringstream os;
+        auto result = convert(bad.begin(),bad.end(),std::ostreambuf_iterator<char>(os));
+        CHECK(result.ec == conv_errc::unpaired_high_surrogate);
+        CHECK(result.it == bad.begin() + 1000);
+        std::string expected_prefix;
+        convert(source.begin(),source.begin() + 1000,std::back_inserter(expected_prefix));
+        CHECK(os.str() == expected_prefix);
+    }
+
+    // The SIMD prefix, the scalar code and the rest at the end all go through 
+    // one block of 4096 bytes, so libstdc++ writes each block with a single sputn.
+    // The SIMD kernels write at most 1024 bytes at a time, so a block is flushed
+    // with more than 3072 bytes in it.
+    SECTION("blocks")
+    {
+        counting_streambuf buf;
+        auto result = convert(long_source.begin(),long_source.end(),std::ostreambuf_iterator<char>(&buf));
+        CHECK(result.ec == conv_errc());
+        CHECK(buf.str == long_expected);
+#if defined(__GLIBCXX__)
+        CHECK(buf.overflow_calls == 0);
+        CHECK(buf.xsputn_calls <= long_expected.size()/3072 + 1);
+#endif
+    }
+
+    SECTION("blocks from a deque")
+    {
+        std::deque<char16_t> deque_source(long_source.begin(),long_source.end());
+        counting_streambuf buf;
+        auto result = convert(deque_source.begin(),deque_source.end(),std::ostreambuf_iterator<char>(&buf));
+        CHECK(result.ec == conv_errc());
+        CHECK(buf.str == long_expected);
+#if defined(__GLIBCXX__)
+        CHECK(buf.overflow_calls == 0);
+        CHECK(buf.xsputn_calls <= long_expected.size()/3072 + 1);
+#endif
+    }
+
+    SECTION("convert_all blocks")
+    {
+        std::u16string bad = long_source;
+        for (std::size_t i = 0; i < 10; ++i)
+        {
+            bad.insert(bad.begin() + 1000*i, static_cast<char16_t>(0xDC00));
+        }
+        std::string all_expected;
+        convert_all(bad.begin(),bad.end(),std::back_inserter(all_expected));
+        counting_streambuf buf;
+        auto result = convert_all(bad.begin(),bad.end(),std::ostreambuf_iterator<char>(&buf));
+        CHECK(result.replacements == 10);
+        CHECK_FALSE(result.out.failed());
+        CHECK(buf.str == all_expected);
+#if defined(__GLIBCXX__)
+        CHECK(buf.overflow_calls == 0);
+        CHECK(buf.xsputn_calls <= all_expected.size()/3072 + 1);
+#endif
+    }
+
+    SECTION("nothing written after the streambuf fails")
+    {
+        counting_streambuf buf;
+        buf.limit = 5000;
+        auto result = convert_all(long_source.begin(),long_source.end(),std::ostreambuf_iterator<char>(&buf));
+        CHECK(result.out.failed());
+        CHECK(buf.str == long_expected.substr(0,5000));
+#if defined(__GLIBCXX__)
+        CHECK(buf.xsputn_calls == 2);
+#endif
+    }
+}
+
+TEST_CASE("convert long same encoding") 
+{
+    std::string source8;
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        source8 += "Hello \xE6\x97\xA5\xE6\x9C\xAC \xf0\x9f\x99\x82!"; // U+65E5 U+672C U+1F642
+    }
+    std::u16string source16;
+    convert(source8.begin(),source8.end(),std::back_inserter(source16));
+    std::u32string source32;
+    convert(source8.begin(),source8.end(),std::back_inserter(source32));
+
+    SECTION("valid")
+    {
+        std::vector<char> target8(source8.size());
+        auto result8 = convert(source8.data(),source8.data() + source8.size(),target8.data());
+        CHECK(result8.ec == conv_errc());
+        CHECK(std::string(target8.begin(),target8.end()) == source8);
+
+        std::u16string target16;
+        auto result16 = convert(source16.begin(),source16.end(),std::back_inserter(target16));
+        CHECK(result16.ec == conv_errc());
+        CHECK(target16 == source16);
+
+        std::u32string target32;
+        auto result32 = convert(source32.begin(),source32.end(),std::back_inserter(target32));
+        CHECK(result32.ec == conv_errc());
+        CHECK(target32 == source32);
+    }
+
+    SECTION("illegal sequence")
+    {
+        std::string bad8 = source8;
+        bad8.insert(1008, "\xE6\x41");
+        std::string target8;
+        auto result8 = convert(bad8.begin(),bad8.end(),std::back_inserter(target8));
+        CHECK(result8.ec == conv_errc::expected_continuation_byte);
+        CHECK(result8.it == bad8.begin() + 1008);
+        CHECK(target8 == source8.substr(0,1008));
+
+        std::u16string bad16 = source16;
+        bad16.insert(bad16.begin() + 700, static_cast<char16_t>(0xDC00));
+        std::u16string target16;
+        auto result16 = convert(bad16.begin(),bad16.end(),std::back_inserter(target16));
+        CHECK(result16.ec == conv_errc::source_illegal);
+        CHECK(result16.it == bad16.begin() + 700);
+        CHECK(target16 == source16.substr(0,700));
+    }
+
+    SECTION("in place")
+    {
+        std::string buffer8 = source8;
+        auto result8 = convert(&buffer8[0],&buffer8[0] + buffer8.size(),&buffer8[0]);
+        CHECK(result8.ec == conv_errc());
+        CHECK(buffer8 == source8);
+
+        std::u16string buffer16 = source16;
+        auto result16 = convert(&buffer16[0],&buffer16[0] + buffer16.size(),&buffer16[0]);
+        CHECK(result16.ec == conv_errc());
+        CHECK(buffer16 == source16);
+    }
+
+    SECTION("target overlaps the source")
+    {
+        std::string buffer8 = "   " + source8;
+        auto result8 = convert(&buffer8[0] + 3,&buffer8[0] + buffer8.size(),&buffer8[0]);
+        CHECK(result8.ec == conv_errc());
+        CHECK(buffer8.substr(0,source8.size()) == source8);
+
+        std::u32string buffer32 = U" " + source32;
+        auto result32 = convert(&buffer32[0] + 1,&buffer32[0] + buffer32.size(),&buffer32[0]);
+        CHECK(result32.ec == conv_errc());
+        CHECK(buffer32.substr(0,source32.size()) == source32);
+    }
+}
@@ -148,3 +148,47 @@ TEST_CASE("is_compatible_output_iterator")
     }
 }
 
+
+TEST_CASE("is_legal_utf8") 
+{
+    SECTION("legal")
+    {
+        CHECK(is_legal_utf8(std::string("A").begin(), 1) == conv_errc());
+        CHECK(is_legal_utf8(std::string("\xD1\x88").begin(), 2) == conv_errc());
+        CHECK(is_legal_utf8(std::string("\xE0\xA0\x80").begin(), 3) == conv_errc());
+        CHECK(is_legal_utf8(std::string("\xED\x9F\xBF").begin(), 3) == conv_errc());
+        CHECK(is_legal_utf8(std::string("\xF0\x90\x80\x80").begin(), 4) == conv_errc());
+        CHECK(is_legal_utf8(std::string("\xF4\x8F\xBF\xBF").begin(), 4) == conv_errc());
+    }
+    SECTION("illegal")
+    {
+        CHECK(is_legal_utf8(std::string("\x80").begin(), 1) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xC1\xBF").begin(), 2) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xE0\x9F\xBF").begin(), 3) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xED\xA0\x80").begin(), 3) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xF0\x8F\xBF\xBF").begin(), 4) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xF4\x90\x80\x80").begin(), 4) == conv_errc::source_illegal);
+        CHECK(is_legal_utf8(std::string("\xF5\x80\x80\x80").begin(), 4) == conv_errc::source_illegal);
+    }
+    SECTION("expected continuation byte takes precedence")
+    {
+        CHECK(is_legal_utf8(std::string("\xE6\x41\x80").begin(), 3) == conv_errc::expected_continuation_byte);
+        CHECK(is_legal_utf8(std::string("\xE0\x80\x41").begin(), 3) == conv_errc::expected_continuation_byte);
+        CHECK(is_legal_utf8(std::string("\xF5\x80\x80\x41").begin(), 4) == conv_errc::expected_continuation_byte);
+        CHECK(is_legal_utf8(std::string("\xC0\x41").begin(), 2) == conv_errc::expected_continuation_byte);
+    }
+    SECTION("over long")
+    {
+        CHECK(is_legal_utf8(std::string("\xF8\x88\x80\x80\x80").begin(), 5) == conv_errc::over_long_utf8_sequence);
+        CHECK(is_legal_utf8(std::string("\xFC\x84\x80\x80\x80\x80").begin(), 6) == conv_errc::over_long_utf8_sequence);
+    }
+}
+
+TEST_CASE("utf8 tables") 
+{
+    CHECK(sizeof(trailing_bytes_for_utf8) == 256);
+    CHECK(trailing_bytes_for_utf8[0x41] == 0);
+    CHECK(trailing_bytes_for_utf8[0xE6] == 2);
+    CHECK(offsets_from_utf8[1] == 0x00003080UL);
+    CHECK(first_byte_mark[4] == 0xF0);
+}
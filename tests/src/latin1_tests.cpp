@@ -0,0 +1,165 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <string>
+#include <iterator>
+ 
+using namespace unicons;
+
+TEST_CASE("convert from latin1") 
+{
+    std::string latin1_text = "Caf\xE9 na\xEFve \xA9 \xFF";
+    std::string utf8 = "Caf\xC3\xA9 na\xC3\xAFve \xC2\xA9 \xC3\xBF";
+
+    SECTION("to utf8")
+    {
+        std::string target;
+        auto result = convert(latin1,latin1_text.begin(),latin1_text.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == latin1_text.end());
+        CHECK(target == utf8);
+    }
+
+    SECTION("to utf16 and utf32")
+    {
+        std::u16string u16;
+        convert(latin1,latin1_text.begin(),latin1_text.end(),std::back_inserter(u16));
+        CHECK(u16 == u"Caf\xE9 na\xEFve \xA9 \xFF");
+
+        std::vector<uint32_t> u32(latin1_text.size());
+        auto result = convert(latin1,latin1_text.data(),latin1_text.data()+latin1_text.size(),u32.data());
+        CHECK(result.ec == conv_errc());
+        CHECK(u32[3] == 0xE9);
+        CHECK(u32.back() == 0xFF);
+    }
+
+    SECTION("non-contiguous bytes")
+    {
+        std::list<char> source(latin1_text.begin(),latin1_text.end());
+        std::string target;
+        auto result = convert(latin1,source.begin(),source.end(),std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == utf8);
+    }
+
+    SECTION("every byte")
+    {
+        std::string source;
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int ch = 0; ch < 256; ++ch)
+            {
+                source.push_back(static_cast<char>(ch));
+            }
+        }
+        std::string target;
+        convert(latin1,source.begin(),source.end(),std::back_inserter(target));
+        std::u32string u32;
+        auto result = convert(target.begin(),target.end(),std::back_inserter(u32));
+        REQUIRE(result.ec == conv_errc());
+        REQUIRE(u32.size() == source.size());
+        for (std::size_t i = 0; i < source.size(); ++i)
+        {
+            CHECK(u32[i] == static_cast<uint8_t>(source[i]));
+        }
+    }
+}
+
+TEST_CASE("convert to latin1") 
+{
+    std::string expected = "Caf\xE9 na\xEFve \xA9 \xFF";
+
+    SECTION("from utf8")
+    {
+        std::string source = "Caf\xC3\xA9 na\xC3\xAFve \xC2\xA9 \xC3\xBF";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),latin1,std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+        CHECK(target == expected);
+    }
+
+    SECTION("from utf16 and utf32")
+    {
+        std::u16string u16 = u"Caf\xE9 na\xEFve \xA9 \xFF";
+        std::string target;
+        auto result = convert(u16.begin(),u16.end(),latin1,std::back_inserter(target));
+        CHECK(result.ec == conv_errc());
+        CHECK(target == expected);
+
+        std::u32string u32 = U"Caf\xE9 na\xEFve \xA9 \xFF";
+        std::vector<char> buffer(u32.size());
+        auto result32 = convert(u32.data(),u32.data()+u32.size(),latin1,buffer.data());
+        CHECK(result32.ec == conv_errc());
+        CHECK(std::string(buffer.begin(),buffer.end()) == expected);
+    }
+
+    SECTION("unmappable character")
+    {
+        std::string source(100,'a');
+        source += "\xC3\xA9\xE2\x82\xAC!"; // U+00E9 U+20AC
+        std::string target;
+        auto result = convert(source.begin(),source.end(),latin1,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::unmappable_character);
+        CHECK(result.it == source.begin() + 102);
+        CHECK(target == std::string(100,'a') + "\xE9");
+
+        std::u16string u16 = u"ab\xD83D\xDE42";
+        target.clear();
+        auto result16 = convert(u16.begin(),u16.end(),latin1,std::back_inserter(target));
+        CHECK(result16.ec == conv_errc::unmappable_character);
+        CHECK(result16.it == u16.begin() + 2);
+        CHECK(target == "ab");
+
+        std::u32string u32 = U"\xFF\x100";
+        target.clear();
+        auto result32 = convert(u32.begin(),u32.end(),latin1,std::back_inserter(target));
+        CHECK(result32.ec == conv_errc::unmappable_character);
+        CHECK(result32.it == u32.begin() + 1);
+    }
+
+    SECTION("illegal sequences")
+    {
+        std::string source = "abc\xC3\x41";
+        std::string target;
+        auto result = convert(source.begin(),source.end(),latin1,std::back_inserter(target));
+        CHECK(result.ec == conv_errc::expected_continuation_byte);
+        CHECK(result.it == source.begin() + 3);
+        CHECK(target == "abc");
+
+        std::u32string u32 = U"ab";
+        u32.push_back(0xD800);
+        target.clear();
+        auto result32 = convert(u32.begin(),u32.end(),latin1,std::back_inserter(target));
+        CHECK(result32.ec == conv_errc::illegal_surrogate_value);
+        CHECK(result32.it == u32.begin() + 2);
+    }
+
+    SECTION("round trip")
+    {
+        std::string source;
+        for (int i = 0; i < 1000; ++i)
+        {
+            source.push_back(static_cast<char>(i % 5 == 0 ? 0xC0 + i % 64 : 'a' + i % 26));
+        }
+        std::string utf8;
+        convert(latin1,source.begin(),source.end(),std::back_inserter(utf8));
+        std::u16string u16;
+        convert(latin1,source.begin(),source.end(),std::back_inserter(u16));
+
+        std::string from_utf8;
+        auto result = convert(utf8.begin(),utf8.end(),latin1,std::back_inserter(from_utf8));
+        CHECK(result.ec == conv_errc());
+        CHECK(from_utf8 == source);
+
+        std::string from_utf16;
+        convert(u16.begin(),u16.end(),latin1,std::back_inserter(from_utf16));
+        CHECK(from_utf16 == source);
+    }
+}
+
@@ -0,0 +1,80 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+using namespace unicons;
+
+namespace {
+
+    // Replaces count code units at every position of valid with each of the 
+    // replacements, and checks that revalidate agrees with validate
+    template <typename CharT>
+    void check_edits(const std::basic_string<CharT>& valid, 
+                     const std::vector<std::basic_string<CharT>>& replacements,
+                     std::size_t count)
+    {
+        for (std::size_t pos = 0; pos + count <= valid.size(); ++pos)
+        {
+            for (const auto& r : replacements)
+            {
+                std::basic_string<CharT> source = valid;
+                source.replace(pos, count, r);
+
+                auto expected = validate(source.begin(), source.end());
+                auto result = revalidate(source.begin(), source.end(), 
+                                         source.begin() + pos, source.begin() + pos + r.size());
+                CHECK(result.ec == expected.ec);
+                CHECK(result.it == expected.it);
+            }
+        }
+    }
+}
+
+TEST_CASE("revalidate utf8")
+{
+    std::string valid = "Hello \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82 world \xf0\x9f\x99\x82";
+    const std::vector<std::string> replacements = {"", "a", "\xD1\x88", "\xE6\x97\xA5", "\x80", "\xE6", "\xE6\x97", 
+                                                   "\xf0\x9f\x99", "\xE0\x80\x80", "\xF8\x88\x80\x80\x80"};
+
+    SECTION("insert")
+    {
+        check_edits(valid, replacements, 0);
+    }
+    SECTION("replace")
+    {
+        check_edits(valid, replacements, 1);
+        check_edits(valid, replacements, 3);
+    }
+    SECTION("splice")
+    {
+        std::string source = valid + valid;
+        source.insert(6, "\xE6\x97\xA5");
+        auto result = revalidate(source.begin(), source.end(), source.begin() + 6, source.begin() + 9);
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == source.end());
+    }
+}
+
+TEST_CASE("revalidate utf16")
+{
+    std::u16string valid = u"Hello \xD83D\xDE42 world \xD83D\xDE42";
+    const std::vector<std::u16string> replacements = {u"", u"a", u"\xD83D\xDE42", u"\xD83D", u"\xDE42"};
+
+    check_edits(valid, replacements, 0);
+    check_edits(valid, replacements, 1);
+    check_edits(valid, replacements, 2);
+}
+
+TEST_CASE("revalidate utf32")
+{
+    std::u32string valid = U"Hello \x1F642 world";
+    const std::vector<std::u32string> replacements = {U"", U"a", std::u32string(1, 0xD800), std::u32string(1, 0x110000)};
+
+    check_edits(valid, replacements, 0);
+    check_edits(valid, replacements, 1);
+}
@@ -0,0 +1,191 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <deque>
+
+using namespace unicons;
+
+TEST_CASE("valid_view from validate")
+{
+    SECTION("valid")
+    {
+        std::string source = "Hello world \xf0\x9f\x99\x82";
+        valid_utf8_view view;
+        CHECK(view.empty());
+        auto result = validate(source.data(), source.data()+source.size(), view);
+        CHECK(result.ec == conv_errc());
+        CHECK(view.begin() == source.data());
+        CHECK(view.end() == source.data()+source.size());
+    }
+    SECTION("invalid")
+    {
+        std::string source = "Hello \x80";
+        valid_view<std::string::iterator> view;
+        auto result = validate(source.begin(), source.end(), view);
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK(view.empty());
+    }
+}
+
+TEST_CASE("convert valid_view")
+{
+    std::string s8 = "Hello \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82 world";
+    std::u16string s16 = u"Hello \x0448\x65E5\xD83D\xDE42 world";
+    std::u32string s32 = U"Hello \x0448\x65E5\x1F642 world";
+
+    SECTION("from UTF-8")
+    {
+        valid_view<std::string::iterator> view(s8.begin(), s8.end(), assume_valid);
+        std::string t8;
+        std::u16string t16;
+        std::u32string t32;
+        auto result = convert(view, std::back_inserter(t8));
+        convert(view, std::back_inserter(t16));
+        convert(view, std::back_inserter(t32));
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == s8.end());
+        CHECK(t8 == s8);
+        CHECK(t16 == s16);
+        CHECK(t32 == s32);
+    }
+    SECTION("from UTF-16")
+    {
+        valid_utf16_view view(s16.data(), s16.data()+s16.size(), assume_valid);
+        std::string t8;
+        std::u16string t16;
+        std::u32string t32;
+        convert(view, std::back_inserter(t8));
+        convert(view, std::back_inserter(t16));
+        convert(view, std::back_inserter(t32));
+        CHECK(t8 == s8);
+        CHECK(t16 == s16);
+        CHECK(t32 == s32);
+    }
+    SECTION("from UTF-32")
+    {
+        valid_utf32_view view(s32.data(), s32.data()+s32.size(), assume_valid);
+        std::string t8;
+        std::u16string t16;
+        std::u32string t32;
+        convert(view, std::back_inserter(t8));
+        convert(view, std::back_inserter(t16));
+        convert(view, std::back_inserter(t32));
+        CHECK(t8 == s8);
+        CHECK(t16 == s16);
+        CHECK(t32 == s32);
+    }
+}
+
+// Converts a valid view of source to a pointer, a contiguous back inserter 
+// and a buffered back inserter, checking each against the checked convert
+template <typename TargetString, typename SourceString>
+void check_long_valid_view(const SourceString& source)
+{
+    typedef typename TargetString::value_type target_unit;
+    valid_view<typename SourceString::const_pointer> view(source.data(), source.data()+source.size(), assume_valid);
+
+    TargetString expected;
+    REQUIRE(convert(source.data(), source.data()+source.size(), std::back_inserter(expected)).ec == conv_errc());
+
+    std::vector<target_unit> buffer(expected.size() + 1);
+    auto result = convert(view, buffer.data());
+    CHECK(result.ec == conv_errc());
+    CHECK(result.it == view.end());
+    CHECK(TargetString(buffer.data(), expected.size()) == expected);
+
+    TargetString appended;
+    convert(view, std::back_inserter(appended));
+    CHECK(appended == expected);
+
+    std::deque<target_unit> buffered;
+    convert(view, std::back_inserter(buffered));
+    CHECK(TargetString(buffered.begin(), buffered.end()) == expected);
+}
+
+TEST_CASE("convert long valid_view")
+{
+    // Long enough to span several chunks, with sequences of every length 
+    // cut by chunk boundaries
+    const char32_t cps[] = {U'a', U'Z', 0x00E9, 0x0448, 0x65E5, 0xFFFD, 0x1F642, 0x10FFFF};
+    std::u32string s32;
+    for (std::size_t i = 0; i < 150000; ++i)
+    {
+        s32.push_back(i % 61 < 40 ? U'x' : cps[(i*7 + i/13) % 8]);
+    }
+    std::string s8;
+    std::u16string s16;
+    convert(s32.data(), s32.data()+s32.size(), std::back_inserter(s8));
+    convert(s32.data(), s32.data()+s32.size(), std::back_inserter(s16));
+
+    SECTION("from UTF-8")
+    {
+        check_long_valid_view<std::string>(s8);
+        check_long_valid_view<std::u16string>(s8);
+        check_long_valid_view<std::u32string>(s8);
+    }
+    SECTION("from UTF-16")
+    {
+        check_long_valid_view<std::string>(s16);
+        check_long_valid_view<std::u16string>(s16);
+        check_long_valid_view<std::u32string>(s16);
+    }
+    SECTION("from UTF-32")
+    {
+        check_long_valid_view<std::string>(s32);
+        check_long_valid_view<std::u16string>(s32);
+        check_long_valid_view<std::u32string>(s32);
+    }
+}
+
+TEST_CASE("u32_length valid_view")
+{
+    std::string s8 = "Hello \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82 world";
+    std::u16string s16 = u"Hello \x0448\x65E5\xD83D\xDE42 world";
+
+    valid_view<std::string::iterator> view8(s8.begin(), s8.end(), assume_valid);
+    valid_view<std::u16string::iterator> view16(s16.begin(), s16.end(), assume_valid);
+    CHECK(u32_length(view8) == u32_length(s8.begin(), s8.end()));
+    CHECK(u32_length(view16) == u32_length(s16.begin(), s16.end()));
+}
+
+TEST_CASE("sequence_generator valid_view")
+{
+    std::string source = "Hi \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82";
+    valid_view<std::string::iterator> view(source.begin(), source.end(), assume_valid);
+
+    auto g = make_sequence_generator(view);
+    sequence_generator<std::string::iterator> expected(source.begin(), source.end());
+    while (!expected.done())
+    {
+        REQUIRE(!g.done());
+        CHECK(g.status() == conv_errc());
+        CHECK(g.get().begin() == expected.get().begin());
+        CHECK(g.get().length() == expected.get().length());
+        CHECK(g.get().codepoint() == expected.get().codepoint());
+        g.next();
+        expected.next();
+    }
+    CHECK(g.done());
+}
+
+TEST_CASE("codepoint_iterator valid_view")
+{
+    std::u16string source = u"Hi \x0448\x65E5\xD83D\xDE42";
+    valid_view<std::u16string::iterator> view(source.begin(), source.end(), assume_valid);
+
+    std::u32string codepoints;
+    for (auto it = make_codepoint_iterator(view); it != end(it); ++it)
+    {
+        codepoints.push_back(*it);
+    }
+    CHECK(codepoints == U"Hi \x0448\x65E5\x1F642");
+
+    std::vector<uint32_t> v(make_codepoint_iterator(view), codepoint_iterator<valid_view<std::u16string::iterator>>());
+    CHECK(v.size() == 6);
+}
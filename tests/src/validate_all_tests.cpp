@@ -0,0 +1,104 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <deque>
+#include <iterator>
+
+using namespace unicons;
+
+TEST_CASE("validate_all utf8")
+{
+    SECTION("valid")
+    {
+        std::string source = "Hello world \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82";
+        std::vector<validation_error> errors;
+        std::size_t n = validate_all(source.begin(), source.end(), std::back_inserter(errors));
+        CHECK(n == 0);
+        CHECK(errors.empty());
+    }
+
+    SECTION("every error")
+    {
+        std::string source = "a\x80\x80\x80" "b\xE0\x80\x80" "c\xE6\x41" "\xED\xA0\x80" "d\xf0\x9f\x99";
+        std::vector<validation_error> errors;
+        std::size_t n = validate_all(source.begin(), source.end(), std::back_inserter(errors));
+        REQUIRE(n == 5);
+        REQUIRE(errors.size() == 5);
+
+        CHECK(errors[0].offset == 1);
+        CHECK(errors[0].length == 3);
+        CHECK(errors[0].ec == conv_errc::source_illegal);
+
+        CHECK(errors[1].offset == 5);
+        CHECK(errors[1].length == 3);
+        CHECK(errors[1].ec == conv_errc::source_illegal);
+
+        CHECK(errors[2].offset == 9);
+        CHECK(errors[2].length == 1);
+        CHECK(errors[2].ec == conv_errc::expected_continuation_byte);
+
+        CHECK(errors[3].offset == 11);
+        CHECK(errors[3].length == 3);
+        CHECK(errors[3].ec == conv_errc::source_illegal);
+
+        CHECK(errors[4].offset == 15);
+        CHECK(errors[4].length == 3);
+        CHECK(errors[4].ec == conv_errc::source_exhausted);
+    }
+
+    SECTION("first error is the error validate reports")
+    {
+        std::string source = "abc\xE0\x80\x80xyz\x80";
+        auto result = validate(source.begin(), source.end());
+        std::vector<validation_error> errors;
+        validate_all(source.begin(), source.end(), std::back_inserter(errors));
+        REQUIRE(!errors.empty());
+        CHECK(errors[0].offset == (std::size_t)(result.it - source.begin()));
+        CHECK(errors[0].ec == result.ec);
+    }
+
+    SECTION("callback and maximum number of errors")
+    {
+        std::string source = "\x80z\x80z\x80z\x80";
+        std::size_t count = 0;
+        std::size_t last_offset = 0;
+        std::size_t n = validate_all(source.begin(), source.end(), 
+                                     [&](const validation_error& err){++count; last_offset = err.offset;}, 2);
+        CHECK(n == 2);
+        CHECK(count == 2);
+        CHECK(last_offset == 2);
+    }
+}
+
+TEST_CASE("validate_all utf16")
+{
+    std::u16string source = u"a\xDC00\xD800\xD83D\xDE42\xD800";
+    std::deque<char16_t> d(source.begin(), source.end());
+    std::vector<validation_error> errors;
+    std::size_t n = validate_all(d.begin(), d.end(), std::back_inserter(errors));
+    REQUIRE(n == 3);
+    CHECK(errors[0].offset == 1);
+    CHECK(errors[0].ec == conv_errc::source_illegal);
+    CHECK(errors[1].offset == 2);
+    CHECK(errors[1].ec == conv_errc::unpaired_high_surrogate);
+    CHECK(errors[2].offset == 5);
+    CHECK(errors[2].length == 1);
+    CHECK(errors[2].ec == conv_errc::source_exhausted);
+}
+
+TEST_CASE("validate_all utf32")
+{
+    std::vector<uint32_t> source = {0x41,0x110000,0x42,0xD800};
+    std::vector<validation_error> errors;
+    std::size_t n = validate_all(source.begin(), source.end(), std::back_inserter(errors));
+    REQUIRE(n == 2);
+    CHECK(errors[0].offset == 1);
+    CHECK(errors[0].ec == conv_errc::source_illegal);
+    CHECK(errors[1].offset == 3);
+    CHECK(errors[1].ec == conv_errc::illegal_surrogate_value);
+}
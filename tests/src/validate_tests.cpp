@@ -5,6 +5,9 @@
 #include <unicode_traits.hpp>
 #include <iostream>
 #include <cstdint>
+#include <vector>
+#include <string>
+#include <deque>
 #include <iterator>
 #include <type_traits>
 
@@ -60,3 +63,185 @@ TEST_CASE("validate utf16")
     }
 }
 
+// Validates a long valid range, with each bad sequence written over it every 
+// step code units, and cut off inside its last sequence, checking the contiguous
+// range against a non-contiguous copy
+template <typename String>
+void check_long_validate(const String& valid, const std::vector<String>& bad, 
+                         std::size_t step, std::size_t last_length)
+{
+    typedef typename String::value_type code_unit;
+
+    auto result = validate(valid.begin(),valid.end());
+    CHECK(result.ec == conv_errc());
+    CHECK(result.it == valid.end());
+    auto result2 = validate(valid.data(),valid.data()+valid.size());
+    CHECK(result2.ec == conv_errc());
+    CHECK(result2.it == valid.data()+valid.size());
+
+    for (std::size_t pos = 0; pos < valid.size(); pos += step)
+    {
+        for (const auto& b : bad)
+        {
+            String source = valid;
+            source.replace(pos, b.size(), b);
+            std::deque<code_unit> d(source.begin(), source.end());
+
+            auto expected = validate(d.begin(),d.end());
+            auto result3 = validate(source.data(),source.data()+source.size());
+            REQUIRE(expected.ec != conv_errc());
+            CHECK(result3.ec == expected.ec);
+            CHECK((result3.it - source.data()) == (expected.it - d.begin()));
+            CHECK(static_cast<std::size_t>(result3.it - source.data()) < pos + b.size());
+        }
+    }
+
+    if (last_length > 1)
+    {
+        String source = valid.substr(0, valid.size() - 1);
+        auto result4 = validate(source.begin(),source.end());
+        CHECK(result4.ec == conv_errc::source_exhausted);
+        CHECK((result4.it - source.begin()) == (std::ptrdiff_t)(valid.size() - last_length));
+    }
+}
+
+TEST_CASE("validate utf8 contiguous range") 
+{
+    // Long enough to exercise the block-at-a-time path
+    std::string valid;
+    for (std::size_t i = 0; i < 40; ++i)
+    {
+        valid += "Hello world \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82";
+    }
+    const std::vector<std::string> bad = {"\x80", "\xC0\x80", "\xE0\x80\x80", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8", "\xE6\x41", "\xF0\x9f\x99"};
+
+    check_long_validate(valid, bad, 7, 4);
+}
+
+TEST_CASE("validate utf16 contiguous range") 
+{
+    // Long enough to exercise the block-at-a-time path, with surrogate
+    // pairs straddling block boundaries
+    std::u16string valid;
+    for (std::size_t i = 0; i < 40; ++i)
+    {
+        valid += u"Hello \x0448\x65E5\xD83D\xDE42";
+    }
+    const std::vector<std::u16string> bad = {u"\xD800\x0041", u"\x0041\xDC00", u"\xD800\xD800", u"\xDBFF\x0041"};
+
+    check_long_validate(valid, bad, 1, 2);
+}
+
+TEST_CASE("validate utf32") 
+{
+    std::u32string valid;
+    for (std::size_t i = 0; i < 40; ++i)
+    {
+        valid += U"Hello \x0448\x65E5\x1F642";
+    }
+    const std::vector<std::u32string> bad = {U"\xD800", U"\xDFFF", std::u32string(1, char32_t(0x110000)), std::u32string(1, char32_t(0xFFFFFFFF))};
+
+    check_long_validate(valid, bad, 1, 1);
+
+    SECTION("out of range value")
+    {
+        std::vector<uint32_t> source = {0x41,0x110000,0x42,0xD800};
+        auto result = validate(source.begin(),source.end());
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK((result.it - source.begin()) == 1);
+    }
+
+    SECTION("negative value")
+    {
+        std::vector<int32_t> source = {0x41,0x42,-1};
+        auto result = validate(source.data(),source.data()+source.size());
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK((result.it - source.data()) == 2);
+    }
+}
+
+TEST_CASE("validate with threads") 
+{
+    const std::size_t num_threads = 4;
+
+    SECTION("utf8")
+    {
+        std::string valid;
+        while (valid.size() < 300000)
+        {
+            valid += "Hello world \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82";
+        }
+        auto result = validate(valid.begin(),valid.end(),num_threads);
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == valid.end());
+
+        // Errors on either side of each chunk boundary
+        const std::vector<std::string> bad = {"\x80", "\xE0\x80\x80", "\xE6\x41", "\xF0\x9f\x99", "\xFC\x80\x80\x80\x80\x80"};
+        for (std::size_t i = 1; i < num_threads; ++i)
+        {
+            std::size_t split = valid.size() / num_threads * i;
+            for (std::size_t pos = split - 8; pos < split + 8; ++pos)
+            {
+                for (const auto& b : bad)
+                {
+                    std::string source = valid;
+                    source.replace(pos, b.size(), b);
+
+                    auto expected = validate(source.begin(),source.end());
+                    auto result2 = validate(source.begin(),source.end(),num_threads);
+                    CHECK(result2.ec == expected.ec);
+                    CHECK(result2.it == expected.it);
+                }
+            }
+        }
+    }
+
+    SECTION("utf16")
+    {
+        std::u16string valid;
+        while (valid.size() < 300000)
+        {
+            valid += u"Hello \x0448\x65E5\xD83D\xDE42";
+        }
+        auto result = validate(valid.begin(),valid.end(),num_threads);
+        CHECK(result.ec == conv_errc());
+        CHECK(result.it == valid.end());
+
+        const std::vector<std::u16string> bad = {u"\xD800", u"\xDC00", u"\xDBFF\x0041"};
+        for (std::size_t i = 1; i < num_threads; ++i)
+        {
+            std::size_t split = valid.size() / num_threads * i;
+            for (std::size_t pos = split - 4; pos < split + 4; ++pos)
+            {
+                for (const auto& b : bad)
+                {
+                    std::u16string source = valid;
+                    source.replace(pos, b.size(), b);
+
+                    auto expected = validate(source.begin(),source.end());
+                    auto result2 = validate(source.begin(),source.end(),num_threads);
+                    CHECK(result2.ec == expected.ec);
+                    CHECK(result2.it == expected.it);
+                }
+            }
+        }
+    }
+
+    SECTION("utf32 earliest error wins")
+    {
+        std::vector<uint32_t> source(300000, 0x41);
+        source[250000] = 0xD800;
+        source[100000] = 0x110000;
+        auto result = validate(source.begin(),source.end(),num_threads);
+        CHECK(result.ec == conv_errc::source_illegal);
+        CHECK((result.it - source.begin()) == 100000);
+    }
+
+    SECTION("small input")
+    {
+        std::string source = "Hello \xE6\x41!";
+        auto result = validate(source.begin(),source.end(),num_threads);
+        CHECK(result.ec == conv_errc::expected_continuation_byte);
+        CHECK((result.it - source.begin()) == 6);
+    }
+}
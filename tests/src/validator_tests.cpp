@@ -0,0 +1,117 @@
+// Copyright 2016 Daniel Parker
+// Distributed under Boost license
+
+#include <catch/catch.hpp>
+#include <unicode_traits.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace unicons;
+
+namespace {
+
+    // Feeds source to a validator in chunks of chunk_size code units
+    template <typename CharT>
+    conv_errc validate_in_chunks(const std::basic_string<CharT>& source, std::size_t chunk_size, std::size_t& error_offset)
+    {
+        validator<CharT> v;
+        for (std::size_t pos = 0; pos < source.size(); pos += chunk_size)
+        {
+            std::size_t n = (std::min)(chunk_size, source.size() - pos);
+            v.feed(source.data() + pos, source.data() + pos + n);
+        }
+        v.finish();
+        error_offset = v.error_offset();
+        return v.status();
+    }
+
+    template <typename CharT>
+    void check_all_chunk_sizes(const std::basic_string<CharT>& source)
+    {
+        auto expected = validate(source.begin(), source.end());
+        for (std::size_t chunk_size = 1; chunk_size <= source.size(); ++chunk_size)
+        {
+            std::size_t error_offset = 0;
+            conv_errc ec = validate_in_chunks(source, chunk_size, error_offset);
+            CHECK(ec == expected.ec);
+            if (expected.ec != conv_errc())
+            {
+                CHECK(error_offset == (std::size_t)(expected.it - source.begin()));
+            }
+        }
+    }
+}
+
+TEST_CASE("validator utf8")
+{
+    SECTION("valid")
+    {
+        check_all_chunk_sizes(std::string("Hello world \xD1\x88\xE6\x97\xA5\xf0\x9f\x99\x82 and more text"));
+    }
+    SECTION("illegal sequence after a chunk boundary")
+    {
+        check_all_chunk_sizes(std::string("Hello \xE6\x97\xA5\xE0\x80\x80 world"));
+    }
+    SECTION("missing continuation byte")
+    {
+        check_all_chunk_sizes(std::string("Hello \xE6\x97\x41 world"));
+    }
+    SECTION("over long lead")
+    {
+        check_all_chunk_sizes(std::string("Hello \xF8\x88\x80\x80\x80 world"));
+    }
+    SECTION("cut off at the end of the stream")
+    {
+        std::string source = "Hello \xf0\x9f\x99";
+        check_all_chunk_sizes(source);
+
+        validator<char> v;
+        CHECK(v.feed(source.begin(), source.end()) == conv_errc());
+        CHECK(v.offset() == source.size());
+        CHECK(v.finish() == conv_errc::source_exhausted);
+        CHECK(v.error_offset() == 6);
+    }
+    SECTION("errors are sticky")
+    {
+        std::string source1 = "\x80";
+        std::string source2 = "abc";
+        validator<char> v;
+        CHECK(v.feed(source1.begin(), source1.end()) == conv_errc::source_illegal);
+        CHECK(v.feed(source2.begin(), source2.end()) == conv_errc::source_illegal);
+        CHECK(v.error_offset() == 0);
+
+        v.reset();
+        CHECK(v.feed(source2.begin(), source2.end()) == conv_errc());
+        CHECK(v.finish() == conv_errc());
+    }
+}
+
+TEST_CASE("validator utf16")
+{
+    SECTION("valid")
+    {
+        check_all_chunk_sizes(std::u16string(u"Hello \xD83D\xDE42 world \xD83D\xDE42"));
+    }
+    SECTION("unpaired high surrogate")
+    {
+        check_all_chunk_sizes(std::u16string(u"Hello \xD83D\x0041 world"));
+    }
+    SECTION("unpaired low surrogate")
+    {
+        check_all_chunk_sizes(std::u16string(u"Hello \xDE42 world"));
+    }
+    SECTION("cut off at the end of the stream")
+    {
+        check_all_chunk_sizes(std::u16string(u"Hello \xD83D"));
+    }
+}
+
+TEST_CASE("validator utf32")
+{
+    std::u32string source = U"Hello \x1F642 world";
+    check_all_chunk_sizes(source);
+    source[3] = 0x110000;
+    check_all_chunk_sizes(source);
+}